@@ -0,0 +1,334 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: aggregate.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "aggregate.hpp"
+#include "const.hpp"
+#include "auxf.hpp"
+#include "store.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::map;
+using std::ostream;
+using std::push_heap;
+using std::pop_heap;
+using std::sort_heap;
+using std::numeric_limits;
+
+namespace {
+
+// the NaN key is written as the NaN row of the histogram
+void writeKey(ostream &out, double key) {
+
+    if (std::isnan(key)) {
+        out << "nan";
+    }
+    else {
+        out << key;
+    }
+
+    out << CSVDELIMITER;
+}
+
+}
+
+bool Aggregate::parse(const string &spec) {
+
+    m_spec = spec;
+
+    vector<string> elem;
+    splitString(spec, elem, ":");
+
+    bool ok = elem.size() >= 2;
+
+    if (ok) {
+        m_col = storeColumnIndex(elem[1]);
+        ok = m_col != STORECOLUMNS;
+    }
+
+    if (ok && (elem[0] == "min" || elem[0] == "max")) {
+
+        m_kind = (elem[0] == "min") ? MIN : MAX;
+
+        if (elem.size() > 2) {
+            ok = stringToCount(elem[2], m_k);
+        }
+
+        if (elem.size() > 3) {
+            m_key = storeColumnIndex(elem[3]);
+        }
+
+        ok = ok && elem.size() <= 4 && m_k > 0 && (elem.size() < 4 || m_key != STORECOLUMNS);
+    }
+    else if (ok && elem[0] == "hist") {
+
+        m_kind = HIST;
+
+        vector<string> range;
+
+        if (elem.size() == 4) {
+            splitString(elem[3], range, ELEMDELIMITER);
+        }
+
+        size_t bins = 0;
+
+        ok = range.size() == 2 && stringToCount(elem[2], bins) && bins >= 1;
+
+        if (ok) {
+            m_bins.assign(bins, 0);
+            m_lo = stringToDouble(range[0]);
+            m_hi = stringToDouble(range[1]);
+            ok = m_lo < m_hi;
+        }
+    }
+    else if (ok && elem[0] == "stats") {
+
+        m_kind = STATS;
+
+        if (elem.size() > 2) {
+            m_key = storeColumnIndex(elem[2]);
+        }
+
+        ok = elem.size() <= 3 && (elem.size() < 3 || m_key != STORECOLUMNS);
+    }
+    else {
+        ok = false;
+    }
+
+    if (!ok) {
+        cout << ERRORMSGBLANK << "Wrong aggregate \"" << spec << "\"!\n";
+    }
+
+    return ok;
+}
+
+bool Aggregate::better(const Row &a, const Row &b) const {
+
+    if (a.value != b.value) {
+        return
+            (m_kind == MIN) ? a.value < b.value : a.value > b.value;
+    }
+
+    return a.index < b.index;
+}
+
+void Aggregate::insert(Group &g, const Row &row) const {
+
+    const auto cmp = [this](const Row &a, const Row &b) { return better(a, b); };
+
+    if (g.top.size() < m_k) {
+        g.top.push_back(row);
+        push_heap(g.top.begin(), g.top.end(), cmp);
+    }
+    else if (better(row, g.top.front())) {
+        pop_heap(g.top.begin(), g.top.end(), cmp);
+        g.top.back() = row;
+        push_heap(g.top.begin(), g.top.end(), cmp);
+    }
+}
+
+void Aggregate::add(uint64_t index, const double *cols) {
+
+    const double value = cols[m_col];
+
+    if (m_kind == HIST) {
+
+        if (std::isnan(value)) {
+            m_nan++;
+        }
+        else if (value < m_lo) {
+            m_below++;
+        }
+        else if (value >= m_hi) {
+            m_above++;
+        }
+        else {
+            const size_t bin = (value - m_lo) / (m_hi - m_lo) * m_bins.size();
+            m_bins[std::min(bin, m_bins.size() - 1)]++;
+        }
+
+        return;
+    }
+
+    if (!std::isfinite(value)) {
+        return;
+    }
+
+    const double key = (m_key == STORECOLUMNS) ? 0.0 : cols[m_key];
+    Group &g = std::isnan(key) ? m_nanGroup : m_groups[key];
+
+    if (m_kind == STATS) {
+        g.min = (g.count == 0 || value < g.min) ? value : g.min;
+        g.max = (g.count == 0 || value > g.max) ? value : g.max;
+        g.sum += value;
+        g.count++;
+        return;
+    }
+
+    Row row;
+
+    row.value = value;
+    row.index = index;
+    memcpy(row.cols, cols, sizeof(row.cols));
+
+    insert(g, row);
+}
+
+void Aggregate::merge(const Aggregate &other) {
+
+    if (m_kind == HIST) {
+
+        for (size_t b=0; b<m_bins.size(); b++) {
+            m_bins[b] += other.m_bins[b];
+        }
+
+        m_below += other.m_below;
+        m_above += other.m_above;
+        m_nan += other.m_nan;
+
+        return;
+    }
+
+    for (map<double, Group>::const_iterator it=other.m_groups.begin();
+         it!=other.m_groups.end(); ++it) {
+        merge(m_groups[it->first], it->second);
+    }
+
+    merge(m_nanGroup, other.m_nanGroup);
+}
+
+void Aggregate::merge(Group &g, const Group &src) const {
+
+    if (m_kind == STATS) {
+        if (src.count > 0) {
+            g.min = (g.count == 0 || src.min < g.min) ? src.min : g.min;
+            g.max = (g.count == 0 || src.max > g.max) ? src.max : g.max;
+            g.sum += src.sum;
+            g.count += src.count;
+        }
+        return;
+    }
+
+    for (size_t i=0; i<src.top.size(); i++) {
+        insert(g, src.top[i]);
+    }
+}
+
+void Aggregate::write(ostream &out) const {
+
+    out << "// " << m_spec << "\n";
+
+    if (m_kind == HIST) {
+
+        const double width = (m_hi - m_lo) / m_bins.size();
+
+        out << "from" << CSVDELIMITER << "to" << CSVDELIMITER << "count\n";
+        out << "-inf" << CSVDELIMITER << m_lo << CSVDELIMITER << m_below << "\n";
+
+        for (size_t b=0; b<m_bins.size(); b++) {
+            out << m_lo + b * width << CSVDELIMITER
+                << m_lo + (b + 1) * width << CSVDELIMITER << m_bins[b] << "\n";
+        }
+
+        out << m_hi << CSVDELIMITER << "inf" << CSVDELIMITER << m_above << "\n";
+
+        if (m_nan > 0) {
+            out << "nan" << CSVDELIMITER << "nan" << CSVDELIMITER << m_nan << "\n";
+        }
+
+        out << "\n";
+
+        return;
+    }
+
+    if (m_key != STORECOLUMNS) {
+        out << storeColumnName(m_key) << CSVDELIMITER;
+    }
+
+    if (m_kind == STATS) {
+        out << "count" << CSVDELIMITER << "min" << CSVDELIMITER
+            << "mean" << CSVDELIMITER << "max\n";
+    }
+    else {
+
+        out << "rank" << CSVDELIMITER << "index";
+
+        for (size_t c=0; c<STORECOLUMNS; c++) {
+            out << CSVDELIMITER << storeColumnName(c);
+        }
+
+        out << "\n";
+    }
+
+    for (map<double, Group>::const_iterator it=m_groups.begin();
+         it!=m_groups.end(); ++it) {
+        write(out, it->first, it->second);
+    }
+
+    if (m_nanGroup.count > 0 || !m_nanGroup.top.empty()) {
+        write(out, numeric_limits<double>::quiet_NaN(), m_nanGroup);
+    }
+
+    out << "\n";
+}
+
+void Aggregate::write(ostream &out, double key, const Group &g) const {
+
+    if (m_kind == STATS) {
+
+        if (m_key != STORECOLUMNS) {
+            writeKey(out, key);
+        }
+
+        out << g.count << CSVDELIMITER << g.min << CSVDELIMITER
+            << g.sum / g.count << CSVDELIMITER << g.max << "\n";
+
+        return;
+    }
+
+    vector<Row> rows(g.top);
+    sort_heap(rows.begin(), rows.end(),
+              [this](const Row &a, const Row &b) { return better(a, b); });
+
+    for (size_t r=0; r<rows.size(); r++) {
+
+        if (m_key != STORECOLUMNS) {
+            writeKey(out, key);
+        }
+
+        out << r + 1 << CSVDELIMITER << rows[r].index;
+
+        for (size_t c=0; c<STORECOLUMNS; c++) {
+            out << CSVDELIMITER << rows[r].cols[c];
+        }
+
+        out << "\n";
+    }
+}
@@ -0,0 +1,98 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: aggregate.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+#include "store.hpp"
+
+// Reduction of the cases of a batch run over the columns of a case (see
+// storeColumnName()), computed as the cases are calculated, so that no
+// table of all of them is kept:
+//
+//   min:col[:K[:key]]      K cases of the lowest col (1 by default),
+//                          for every value of key if it is given
+//   max:col[:K[:key]]      the same for the highest col
+//   hist:col:bins:lo,hi    histogram of col over [lo, hi)
+//   stats:col[:key]        count, min, mean and max of col
+//
+// e.g. "min:ge:10", "min:ge:1:n" (the best case for every speed) or
+// "hist:P_fire_max:20:10000,20000". Every worker adds its cases to its
+// own copy; the copies are merged at the end. The ties are broken by the
+// index of the case, so the result does not depend on the scheduling.
+class Aggregate {
+
+public:
+
+    bool parse(const std::string &);
+
+    void add(uint64_t index, const double *cols);
+    void merge(const Aggregate &);
+    void write(std::ostream &) const;
+
+private:
+
+    enum Kind { MIN, MAX, HIST, STATS };
+
+    struct Row {
+        double   value = 0;
+        uint64_t index = 0;
+        double   cols[STORECOLUMNS] = {};
+    };
+
+    struct Group {
+        std::vector<Row> top; // heap, the worst row on the top
+        uint64_t count = 0;
+        double   sum   = 0;
+        double   min   = 0;
+        double   max   = 0;
+    };
+
+    bool better(const Row &, const Row &) const;
+    void insert(Group &, const Row &) const;
+    void merge(Group &, const Group &) const;
+    void write(std::ostream &, double, const Group &) const;
+
+    std::string m_spec;
+    Kind        m_kind  = MIN;
+    size_t      m_col   = 0;
+    size_t      m_k     = 1;
+    size_t      m_key   = STORECOLUMNS; // none
+
+    std::map<double, Group> m_groups;
+    Group m_nanGroup; // of the NaN keys, which do not order in the map
+
+    double m_lo = 0;
+    double m_hi = 0;
+    std::vector<uint64_t> m_bins;
+    uint64_t m_below = 0;
+    uint64_t m_above = 0;
+    uint64_t m_nan   = 0;
+
+};
+
+#endif // AGGREGATE_HPP
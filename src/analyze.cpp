@@ -0,0 +1,529 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: analyze.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "analyze.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "cycle.hpp"
+#include "sched.hpp"
+#include "mapfile.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <regex>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <cstring>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::regex;
+using std::regex_match;
+using std::setprecision;
+using std::defaultfloat;
+using std::numeric_limits;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace {
+
+const size_t L = ANALYZELANES;
+
+// per-cycle constants of the analysis
+struct Setup {
+    FireParams fp;
+    double betamax = 0;
+    double kgf     = 0; // kPa to kgf/cm2
+    double vd      = 0; // displacement per unit va
+    size_t start   = 0; // index of -teta
+    size_t end     = 0; // last index of the combustion
+    vector<double> phi;
+    vector<double> psialpha;
+    vector<double> v; // per unit va
+};
+
+// state of a worker, allocated on the worker thread
+struct Worker {
+    vector<double> p; // points x lanes, kPa
+    vector<double> x;
+    vector<double> sumP;
+    vector<double> sumX;
+    vector<double> sumW;
+    size_t cycles = 0;
+};
+
+template <typename T>
+void loadLanes(const char *data, size_t points, size_t first, size_t count,
+               double scale, double *p) {
+
+    // the lanes beyond the count repeat the last cycle
+    for (size_t l=0; l<L; l++) {
+
+        const T *src = reinterpret_cast<const T *>(data) +
+            (first + (l < count ? l : count - 1)) * points;
+
+        for (size_t i=0; i<points; i++) {
+            T s;
+            memcpy(&s, src + i, sizeof(s));
+            p[i * L + l] = s * scale;
+        }
+    }
+}
+
+void analyzeLanes(const Setup &st, size_t points, Worker &w,
+                  Analyze::CycleStats *stats, size_t count) {
+
+    const double *p = w.p.data();
+    double *x = w.x.data();
+
+    double pmax[L];
+    double imax[L];
+    double work[L];
+
+    for (size_t l=0; l<L; l++) {
+        pmax[l] = p[l];
+        imax[l] = 0;
+        work[l] = 0;
+    }
+
+    for (size_t i=1; i<points; i++) {
+
+        const double dv = st.v[i] - st.v[i-1];
+
+        for (size_t l=0; l<L; l++) {
+
+            const double pi = p[i * L + l];
+            const bool higher = pi > pmax[l];
+
+            pmax[l] = higher ? pi : pmax[l];
+            imax[l] = higher ? i : imax[l];
+            work[l] += (p[(i-1) * L + l] + pi) / 2.0 * dv;
+        }
+    }
+
+    // the fire phase backwards, from the pressure to x
+
+    const FireParams &fp = st.fp;
+
+    double x0[L];
+    double k0[L];
+    double p0[L];
+    double t0[L];
+    double beta0[L];
+
+    const double psi_y = st.psialpha[st.start];
+
+    for (size_t l=0; l<L; l++) {
+
+        p0[l] = p[st.start * L + l] * st.kgf;
+
+        FireParams first = fp;
+        first.py = p0[l];
+        first.ty = fp.k_ty * p0[l] * psi_y;
+
+        double ks = 0;
+        cycleFireFirst(first, 0.0, k0[l], ks, p0[l], t0[l]);
+
+        x0[l] = 0;
+        beta0[l] = 1;
+    }
+
+    for (size_t i=0; i<=st.start; i++) {
+        for (size_t l=0; l<L; l++) {
+            x[i * L + l] = 0;
+        }
+    }
+
+    for (size_t i=st.start+1; i<=st.end; i++) {
+
+        const double psi0 = st.psialpha[i-1];
+        const double psi1 = st.psialpha[i];
+
+        for (size_t l=0; l<L; l++) {
+
+            const double p1 = p[i * L + l] * st.kgf;
+
+            double x1 = 0;
+            double k1 = 0;
+            double t1 = 0;
+
+            cycleBurnFromPressure(fp, st.betamax, x0[l], psi0, psi1,
+                                  beta0[l], k0[l], p0[l], t0[l], p1,
+                                  x1, k1, t1);
+
+            x[i * L + l] = x1;
+
+            x0[l] = x1;
+            k0[l] = k1;
+            p0[l] = p1;
+            t0[l] = t1;
+            beta0[l] = 1.0 + (st.betamax - 1.0) * x1;
+        }
+    }
+
+    for (size_t i=st.end+1; i<points; i++) {
+        for (size_t l=0; l<L; l++) {
+            x[i * L + l] = x[st.end * L + l];
+        }
+    }
+
+    // statistics of the real cycles of the lanes
+
+    const double phiz = (st.end - st.start) * (st.phi[1] - st.phi[0]);
+    const double dphi = st.phi[1] - st.phi[0];
+
+    for (size_t l=0; l<count; l++) {
+
+        Analyze::CycleStats &cs = stats[l];
+
+        cs.pmax = pmax[l];
+        cs.phiPmax = st.phi[size_t(imax[l])];
+        cs.imep = work[l] / st.vd;
+        cs.xEnd = x[st.end * L + l];
+        cs.phiX50 = numeric_limits<double>::quiet_NaN();
+
+        for (size_t i=st.start+1; i<=st.end; i++) {
+
+            const double xa = x[(i-1) * L + l];
+            const double xb = x[i * L + l];
+
+            if (xb >= 0.5) {
+                cs.phiX50 = st.phi[i-1] + ((xb > xa) ? (0.5 - xa) / (xb - xa) * dphi : 0);
+                break;
+            }
+        }
+
+        for (size_t i=0; i<points; i++) {
+            w.sumP[i] += p[i * L + l];
+            w.sumX[i] += x[i * L + l];
+        }
+
+        for (size_t i=st.start+1; i<=st.end; i++) {
+            w.sumW[i] += (x[i * L + l] - x[(i-1) * L + l]) / dphi * phiz;
+        }
+    }
+
+    w.cycles += count;
+}
+
+}
+
+Analyze::Analyze(const shared_ptr<Conf> &conf,
+                 const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+bool Analyze::readTaskFile(const string &filename) {
+
+    ifstream fin(filename);
+
+    if (!fin) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << filename << "\" to read!\n";
+        return false;
+    }
+
+    string s;
+    vector<string> elem;
+
+    while (!fin.eof()) {
+
+        getline(fin, s);
+
+        if (!s.empty() && s[s.size()-1] == '\r') {
+            s.erase(s.size()-1);
+        }
+
+        if (regex_match(s, regex(COMMENTREGEX)) || s.empty()) {
+            continue;
+        }
+
+        splitString(s, elem, PARAMDELIMITER);
+
+        const string key = (elem.size() == 2) ? elem[0] : "";
+        const string val = (elem.size() == 2) ? elem[1] : "";
+
+        size_t count = 0;
+
+        if (key == "file") {
+            m_file = val;
+        }
+        else if (key == "format" && (val == "float32" || val == "float64")) {
+            m_sampleSize = (val == "float32") ? 4 : 8;
+        }
+        else if (key == "header" && stringToCount(val, count)) {
+            m_header = count;
+        }
+        else if (key == "from") {
+            m_from = stringToDouble(val);
+        }
+        else if (key == "step") {
+            m_step = stringToDouble(val);
+        }
+        else if (key == "points" && stringToCount(val, count)) {
+            m_points = count;
+        }
+        else if (key == "scale") {
+            m_scale = stringToDouble(val);
+        }
+        else {
+            cout << ERRORMSGBLANK << "Wrong line \"" << s
+                 << "\" in file \"" << filename << "\"!\n";
+            return false;
+        }
+
+        elem.clear();
+    }
+
+    fin.close();
+
+    if (m_file.empty() || m_points < 2 || !(m_step > 0)) {
+        cout << ERRORMSGBLANK << "No file, points or step in file \""
+             << filename << "\"!\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool Analyze::run() {
+
+    if (!readTaskFile(m_opts->val_analyzefile())) {
+        return false;
+    }
+
+    const Conf &conf = *m_conf;
+
+    Setup st;
+
+    InletState inlet;
+    cycleInlet(conf, inlet);
+
+    st.fp.eps   = conf.val_eps();
+    st.fp.va    = inlet.va;
+    st.fp.alpha = conf.val_alpha();
+    st.fp.qz    = cycleQz(conf, inlet);
+    st.fp.k_ty  = inlet.ta / inlet.pa / conf.val_eps();
+    st.betamax  = cycleBetamax(conf, inlet);
+    st.kgf      = kpa_to_kgfcm2(1.0);
+    st.vd       = 1.0 - 1.0 / conf.val_eps();
+
+    const double lam = conf.val_r() / conf.val_l();
+    const double start = (-conf.val_teta() - m_from) / m_step;
+
+    if (start < 0 || start + 1 >= m_points) {
+        cout << ERRORMSGBLANK << "The start of the combustion -teta is out of the cycle!\n";
+        return false;
+    }
+
+    st.start = lround(start);
+    st.end = std::min<size_t>(st.start + size_t(conf.val_phiz() / m_step), m_points - 1);
+
+    st.phi.resize(m_points);
+    st.psialpha.resize(m_points);
+    st.v.resize(m_points);
+
+    for (size_t i=0; i<m_points; i++) {
+
+        double sigma = 0;
+
+        st.phi[i] = m_from + i * m_step;
+        cycleKinematicsPoint(st.phi[i], lam, conf.val_eps(), 1.0, sigma, st.psialpha[i], st.v[i]);
+    }
+
+    MapFile map;
+
+    if (!map.open(m_file)) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << m_file << "\" to read!\n";
+        return false;
+    }
+
+    const size_t cycleBytes = m_points * m_sampleSize;
+    const size_t cycles = (map.size() > m_header) ? (map.size() - m_header) / cycleBytes : 0;
+
+    if (cycles == 0) {
+        cout << ERRORMSGBLANK << "No cycles in file \"" << m_file << "\"!\n";
+        return false;
+    }
+
+    if (m_header + cycles * cycleBytes != map.size()) {
+        cout << WARNMSGBLANK << "The last cycle of file \"" << m_file
+             << "\" is incomplete and skipped.\n";
+    }
+
+    const char *data = map.data() + m_header;
+
+    Sched sched(m_opts->val_threads(), m_opts->val_pin());
+    vector<unique_ptr<Worker>> workers(sched.workers());
+    vector<CycleStats> stats(cycles);
+
+    const size_t chunks = (cycles + ANALYZECHUNK - 1) / ANALYZECHUNK;
+    const size_t points = m_points;
+    const size_t sampleSize = m_sampleSize;
+    const double scale = m_scale;
+
+    cout << MSGBLANK << cycles << " cycles of " << points << " points, "
+         << sched.workers() << " worker(s).\n";
+
+    const steady_clock::time_point t0 = steady_clock::now();
+
+    sched.run(
+        chunks,
+        [&](size_t) {
+            return 1.0;
+        },
+        [&](size_t w) {
+            Worker *worker = new Worker();
+            worker->p.resize(points * L);
+            worker->x.resize(points * L);
+            worker->sumP.resize(points, 0);
+            worker->sumX.resize(points, 0);
+            worker->sumW.resize(points, 0);
+            workers[w].reset(worker);
+        },
+        [&](size_t w, size_t job) {
+
+            Worker &worker = *workers[w];
+
+            const size_t last = std::min(cycles, (job + 1) * ANALYZECHUNK);
+
+            for (size_t c=job*ANALYZECHUNK; c<last; c+=L) {
+
+                const size_t count = std::min(L, last - c);
+
+                if (sampleSize == 4) {
+                    loadLanes<float>(data, points, c, count, scale, worker.p.data());
+                }
+                else {
+                    loadLanes<double>(data, points, c, count, scale, worker.p.data());
+                }
+
+                analyzeLanes(st, points, worker, &stats[c], count);
+            }
+        }
+        );
+
+    const duration<double> elapsed = steady_clock::now() - t0;
+
+    vector<double> sumP(points, 0);
+    vector<double> sumX(points, 0);
+    vector<double> sumW(points, 0);
+
+    for (size_t w=0; w<workers.size(); w++) {
+        if (workers[w]) {
+            for (size_t i=0; i<points; i++) {
+                sumP[i] += workers[w]->sumP[i];
+                sumX[i] += workers[w]->sumX[i];
+                sumW[i] += workers[w]->sumW[i];
+            }
+            workers[w].reset();
+        }
+    }
+
+    cout << MSGBLANK << cycles << " cycles analyzed in " << elapsed.count() << " s ("
+         << cycles / elapsed.count() << " cycles/s, "
+         << cycles * cycleBytes / elapsed.count() / 1048576.0 << " MB/s).\n";
+
+    // reports
+
+    const string dateTime = currDateTime();
+
+    string cyclesFilename = m_opts->val_output();
+
+    if (cyclesFilename.empty()) {
+        cyclesFilename = string(PRGNAME) + "_cycles_" + dateTime + ".csv";
+    }
+
+    const string curvesFilename = string(PRGNAME) + "_curves_" + dateTime + ".csv";
+
+    ofstream fout(cyclesFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << cyclesFilename << "\" to write!\n";
+        return false;
+    }
+
+    fout << "cycle" << CSVDELIMITER << "P_max" << CSVDELIMITER << "phi_P_max"
+         << CSVDELIMITER << "IMEP" << CSVDELIMITER << "x_end"
+         << CSVDELIMITER << "phi_x50\n" << defaultfloat << setprecision(10);
+
+    for (size_t c=0; c<cycles; c++) {
+        fout << c
+             << CSVDELIMITER << stats[c].pmax
+             << CSVDELIMITER << stats[c].phiPmax
+             << CSVDELIMITER << stats[c].imep
+             << CSVDELIMITER << stats[c].xEnd
+             << CSVDELIMITER << stats[c].phiX50 << "\n";
+    }
+
+    fout.close();
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << cyclesFilename << "\"!\n";
+        return false;
+    }
+
+    fout.open(curvesFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << curvesFilename << "\" to write!\n";
+        return false;
+    }
+
+    fout << "phi" << CSVDELIMITER << "p" << CSVDELIMITER << "x"
+         << CSVDELIMITER << "w0\n";
+
+    for (size_t i=0; i<points; i++) {
+        fout << st.phi[i]
+             << CSVDELIMITER << sumP[i] / cycles
+             << CSVDELIMITER << sumX[i] / cycles
+             << CSVDELIMITER << sumW[i] / cycles << "\n";
+    }
+
+    fout.close();
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << curvesFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << "Report files \"" << cyclesFilename << "\" and \""
+         << curvesFilename << "\" created.\n\n";
+
+    return true;
+}
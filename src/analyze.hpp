@@ -0,0 +1,91 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: analyze.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ANALYZE_HPP
+#define ANALYZE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "conf.hpp"
+#include "opts.hpp"
+
+// Heat release analysis of the measured cylinder pressure, the inverse
+// of the fire phase: the apparent burnt fraction x and w0 are found from
+// p(phi) by the same kinematics and k(T) relations as the model uses.
+//
+// The DAQ file is a sequence of cycles of raw samples, described by the
+// file given to --analyze:
+//
+//   file=cell3_shift1.bin
+//   format=float32
+//   header=0
+//   from=-180
+//   step=0.5
+//   points=721
+//   scale=1
+//
+// format is float32 or float64 (little-endian), header is the number of
+// bytes before the first cycle, from and step are the angles of the first
+// sample of a cycle and between the samples, points is the number of the
+// samples of a cycle and scale converts them to kPa.
+//
+// The combustion starts at -teta and lasts phiz of the configuration,
+// which gives the engine and the charge too. The file is memory-mapped
+// and the cycles are analyzed in parallel chunks, ANALYZELANES cycles at
+// once in the innermost loops, so that they are vectorized. The results
+// are P_max, its angle, IMEP, the final x and the angle of x = 0.5 of
+// every cycle, and the cycle-averaged p, x and w0 curves.
+class Analyze {
+
+public:
+
+    Analyze(const std::shared_ptr<Conf> &conf,
+            const std::shared_ptr<Opts> &opts);
+
+    bool run();
+
+    struct CycleStats {
+        double pmax    = 0; // kPa
+        double phiPmax = 0;
+        double imep    = 0; // kPa
+        double xEnd    = 0;
+        double phiX50  = 0;
+    };
+
+private:
+
+    bool readTaskFile(const std::string &);
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+
+    std::string m_file;
+    size_t      m_sampleSize = 4;
+    size_t      m_header     = 0;
+    double      m_from       = -180;
+    double      m_step       = 1;
+    size_t      m_points     = 0;
+    double      m_scale      = 1;
+
+};
+
+#endif // ANALYZE_HPP
@@ -21,7 +21,20 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
 #include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "auxf.hpp"
 
@@ -29,6 +42,11 @@ using std::string;
 using std::vector;
 using std::ostringstream;
 using std::istringstream;
+using std::ifstream;
+using std::istreambuf_iterator;
+using std::hex;
+using std::setw;
+using std::setfill;
 
 string uintToString(size_t x) {
 
@@ -49,6 +67,27 @@ double stringToDouble(const string &str) {
     return val;
 }
 
+// the whole string is a non-negative integer
+bool stringToCount(const string &str, size_t &val) {
+
+    if (str.empty() || !isdigit(static_cast<unsigned char>(str[0]))) {
+        return false;
+    }
+
+    char *end = nullptr;
+    errno = 0;
+
+    const unsigned long long n = strtoull(str.c_str(), &end, 10);
+
+    if (*end != '\0' || errno == ERANGE || n > static_cast<size_t>(-1)) {
+        return false;
+    }
+
+    val = n;
+
+    return true;
+}
+
 bool stringToBool(const string &str) {
 
     istringstream stm;
@@ -121,6 +160,69 @@ double kgfmkg_to_j(double kgfmkg) {
         kgfmkg * 0.10197162;
 }
 
+bool readFile(const string &filename, string &data) {
+
+    ifstream fin(filename, std::ios::binary);
+
+    if (!fin) {
+        return false;
+    }
+
+    data.assign((istreambuf_iterator<char>(fin)),
+                (istreambuf_iterator<char>()));
+
+    return true;
+}
+
+bool syncFile(FILE *f) {
+
+    if (fflush(f) != 0) {
+        return false;
+    }
+
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+bool replaceFile(const string &from, const string &to) {
+
+#ifdef _WIN32
+    std::remove(to.c_str());
+#endif
+
+    return
+        std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+// FNV-1a
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash) {
+
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+
+    for (size_t i=0; i<size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+uint64_t hashString(const string &str, uint64_t hash) {
+    return
+        hashBytes(str.data(), str.size(), hash);
+}
+
+string hashToString(uint64_t hash) {
+
+    ostringstream stm;
+    stm << hex << setw(16) << setfill('0') << hash;
+
+    return stm.str();
+}
+
 double maxValue(const vector<double> &v) {
 
     double maxv = v[0];
@@ -23,9 +23,12 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <cstdio>
 
 std::string uintToString(size_t);
 double stringToDouble(const std::string &);
+bool stringToCount(const std::string &, size_t &); // non-negative integer
 bool stringToBool(const std::string &);
 void splitString(
     const std::string &,        // source string
@@ -42,4 +45,11 @@ double kgfmkg_to_j(double);
 
 double maxValue(const std::vector<double> &);
 
+bool readFile(const std::string &, std::string &);
+bool syncFile(FILE *);
+bool replaceFile(const std::string &, const std::string &); // from, to
+uint64_t hashBytes(const void *, size_t, uint64_t = 14695981039346656037ULL);
+uint64_t hashString(const std::string &, uint64_t = 14695981039346656037ULL);
+std::string hashToString(uint64_t);
+
 #endif // AUXF_HPP
@@ -0,0 +1,571 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: batch.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batch.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "calc.hpp"
+#include "sweep.hpp"
+#include "sched.hpp"
+#include "result.hpp"
+#include "journal.hpp"
+#include "store.hpp"
+#include "metrics.hpp"
+#include "aggregate.hpp"
+#include "filter.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::sort;
+using std::max;
+using std::fill;
+using std::numeric_limits;
+using std::setprecision;
+using std::defaultfloat;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+namespace {
+
+// state of a worker, allocated on the worker thread
+struct Worker {
+    shared_ptr<Conf> conf;
+    unique_ptr<Calc> calc;
+    vector<Result> results;
+
+    // closed cycle statistics
+    size_t evals = 0;
+    size_t maxEvals = 0;
+
+    size_t failed = 0; // cases of the NaN outputs
+
+    // partial aggregates of the cases of this worker
+    vector<Aggregate> aggregates;
+    size_t aggregated = 0;
+};
+
+bool lessIndex(const Result &a, const Result &b) {
+    return a.index < b.index;
+}
+
+}
+
+Batch::Batch(const shared_ptr<Conf> &conf,
+             const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+bool Batch::run() {
+
+    const bool table = !m_opts->val_tablefile().empty();
+    const bool doe = m_opts->val_doe();
+    const string casesFilename =
+        table ? m_opts->val_tablefile() :
+        doe ? m_opts->val_doefile() : m_opts->val_sweepfile();
+
+    Sweep sweep;
+
+    if (table ? !sweep.readTableFile(casesFilename) :
+        doe ? !sweep.readDoeFile(casesFilename) :
+        !sweep.readSweepFile(casesFilename)) {
+        return false;
+    }
+
+    // the partial results of the shards may be merged, and the journal
+    // resumed, only if all of them were calculated from the same source
+    // data with the same options of the results; the options at their
+    // defaults add nothing, so the plain runs keep their source
+
+    string data;
+    uint64_t hash = hashString("");
+
+    if (readFile(CONFIGFILE, data)) {
+        hash = hashString(data, hash);
+    }
+
+    if (readFile(casesFilename, data)) {
+        hash = hashString(data, hash);
+    }
+
+    if (m_opts->val_closed()) {
+        hash = hashString("--closed", hash);
+    }
+
+    for (size_t a=0; a<m_opts->val_aggregates().size(); a++) {
+        hash = hashString("--aggregate " + m_opts->val_aggregates()[a], hash);
+    }
+
+    if (!m_opts->val_where().empty()) {
+        hash = hashString("--where " + m_opts->val_where(), hash);
+    }
+
+    m_source = hashToString(hash);
+    m_cases = sweep.size();
+
+    // with the aggregates the cases are reduced as they are calculated
+    // and never kept, so there is nothing to journal or store
+
+    const vector<string> &specs = m_opts->val_aggregates();
+    const bool aggregate = !specs.empty();
+
+    vector<Aggregate> aggregates(specs.size());
+    Filter where;
+
+    for (size_t a=0; a<specs.size(); a++) {
+        if (!aggregates[a].parse(specs[a])) {
+            return false;
+        }
+    }
+
+    if (!where.parse(m_opts->val_where())) {
+        return false;
+    }
+
+    if (aggregate && (m_opts->val_journal() || m_opts->val_store())) {
+        cout << ERRORMSGBLANK << "The aggregates can not be journaled or stored!\n";
+        return false;
+    }
+
+    // the partial aggregates of a shard would not be merged
+    if (aggregate && m_opts->val_shards() > 1) {
+        cout << ERRORMSGBLANK << "The aggregates can not be sharded!\n";
+        return false;
+    }
+
+    const size_t shards = m_opts->val_shards();
+    const size_t first = m_opts->val_shard() - 1;
+    const size_t n = (m_cases > first) ? (m_cases - first + shards - 1) / shards : 0;
+
+    const Conf &base = *m_conf;
+
+    Sched sched(m_opts->val_threads(), m_opts->val_pin());
+    vector<unique_ptr<Worker>> workers(sched.workers());
+
+    cout << MSGBLANK << n << " cases";
+
+    if (shards > 1) {
+        cout << " (shard " << first + 1 << "/" << shards << " of " << m_cases << ")";
+    }
+
+    cout << ", " << sched.workers() << " worker(s).\n";
+
+    unique_ptr<Journal> journal;
+
+    if (m_opts->val_journal()) {
+
+        string journalFilename = string(PRGNAME) + "_journal";
+
+        if (shards > 1) {
+            journalFilename +=
+                "_shard_" + uintToString(first + 1) + "-of-" + uintToString(shards);
+        }
+
+        journal.reset(new Journal(journalFilename + ".bin", m_source, m_cases));
+
+        if (!journal->open(sched.workers())) {
+            return false;
+        }
+
+        if (journal->completed() > 0) {
+            cout << MSGBLANK << journal->completed() << " cases found in journal \""
+                 << journalFilename << ".bin\", resuming.\n";
+        }
+    }
+
+    if (m_opts->val_metrics()) {
+
+        m_metrics.reset(new Metrics(m_opts->val_metricsfile(), sched.workers(), n));
+
+        m_metrics->setQueues([&](vector<size_t> &queues) { sched.queued(queues); });
+
+        if (journal) {
+            Journal *j = journal.get();
+            m_metrics->setBytes([j]() { return j->written(); });
+        }
+
+        m_metrics->start();
+    }
+
+    const bool closed = m_opts->val_closed();
+    const size_t trIndex = Conf::keyIndex("tr");
+
+    // Every closed cycle starts from the one of the base configuration,
+    // not from the previous case of its worker: the result of a case does
+    // not depend on the scheduling, and the shards and a resumed run give
+    // the same results as the whole run.
+
+    double startTr = 0;
+    double startSlope = 0;
+
+    if (closed) {
+
+        shared_ptr<Conf> conf(new Conf(base));
+        Calc calc(conf);
+        size_t evals = 0;
+
+        calc.setParallel(false);
+
+        if (calc.calculateClosed(evals)) {
+            startTr = conf->val_tr();
+            startSlope = calc.trSlope();
+        }
+    }
+
+    // the cost depends on da and phiz only, the case is built for it
+    // just when one of them varies
+
+    const bool costVaries =
+        sweep.varies(Conf::keyIndex("da")) || sweep.varies(Conf::keyIndex("phiz"));
+    const double baseCost = Calc::cost(base);
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    sched.run(
+        n,
+        [&](size_t job) {
+            if (journal && journal->done(first + job * shards)) {
+                return 0.0;
+            }
+            if (!costVaries) {
+                return baseCost;
+            }
+            Conf conf(base);
+            sweep.makeConf(first + job * shards, conf);
+            return Calc::cost(conf);
+        },
+        [&](size_t w) {
+            Worker *worker = new Worker();
+            worker->conf.reset(new Conf(base));
+            worker->calc.reset(new Calc(worker->conf));
+            worker->calc->setParallel(false);
+            if (aggregate) {
+                worker->aggregates = aggregates;
+            }
+            else if (!journal) {
+                worker->results.reserve(n / workers.size() + 1);
+            }
+            workers[w].reset(worker);
+        },
+        [&](size_t w, size_t job) {
+            if (journal && journal->done(first + job * shards)) {
+                if (m_metrics) {
+                    m_metrics->cached(w);
+                }
+                return;
+            }
+
+            const steady_clock::time_point jobStart = steady_clock::now();
+
+            Worker &worker = *workers[w];
+            *worker.conf = base;
+            sweep.makeConf(first + job * shards, *worker.conf);
+
+            Result res;
+            res.index = first + job * shards;
+
+            bool failed = false;
+
+            if (closed) {
+
+                if (startTr > 0) {
+                    worker.conf->setValue(trIndex, startTr);
+                }
+
+                worker.calc->setTrSlope(startSlope);
+
+                size_t evals = 0;
+
+                failed = !worker.calc->calculateClosed(evals);
+
+                worker.evals += evals;
+                worker.maxEvals = max(worker.maxEvals, evals);
+            }
+            else {
+                failed = !worker.calc->calculate();
+            }
+
+            // the inputs with the tr of the closed cycle; the outputs of
+            // a case of wrong angles or of a cycle which did not close are
+            // not results
+            worker.conf->values(res.in);
+
+            if (failed) {
+                fill(res.out, res.out + CALCOUTPUTS, numeric_limits<double>::quiet_NaN());
+                worker.failed++;
+            }
+            else {
+                worker.calc->outputs(res.out);
+            }
+
+            if (m_metrics) {
+                m_metrics->evaluated(
+                    w, duration_cast<nanoseconds>(steady_clock::now() - jobStart).count());
+            }
+
+            if (aggregate) {
+
+                double cols[STORECOLUMNS];
+
+                memcpy(cols, res.in, sizeof(res.in));
+                memcpy(cols + CONFFIELDS, res.out, sizeof(res.out));
+
+                if (where.empty() || where.matches(cols)) {
+                    for (size_t a=0; a<worker.aggregates.size(); a++) {
+                        worker.aggregates[a].add(res.index, cols);
+                    }
+                }
+
+                worker.aggregated++;
+            }
+            else if (journal) {
+                journal->append(w, res);
+            }
+            else {
+                worker.results.push_back(res);
+            }
+        }
+        );
+
+    const duration<double> elapsed = steady_clock::now() - start;
+
+    // the writer thread must not outlive the scheduler it asks for the
+    // queues; the report bytes are added by the final write
+
+    if (m_metrics) {
+        m_metrics->setQueues(nullptr);
+    }
+
+    // the aggregated cases are not kept
+    vector<Result> results;
+
+    if (!aggregate) {
+        results.reserve(n);
+    }
+
+    // with the journal the results of the previous runs are in it too
+
+    if (journal && (!journal->close() || !journal->readAll(results))) {
+        cout << ERRORMSGBLANK << "Can not read the journal back!\n";
+        return false;
+    }
+
+    size_t evals = 0;
+    size_t maxEvals = 0;
+    size_t failed = 0;
+    size_t aggregated = 0;
+
+    for (size_t w=0; w<workers.size(); w++) {
+        if (workers[w]) {
+            for (size_t a=0; a<aggregates.size(); a++) {
+                aggregates[a].merge(workers[w]->aggregates[a]);
+            }
+            aggregated += workers[w]->aggregated;
+            evals += workers[w]->evals;
+            maxEvals = max(maxEvals, workers[w]->maxEvals);
+            failed += workers[w]->failed;
+            results.insert(results.end(),
+                           workers[w]->results.begin(),
+                           workers[w]->results.end());
+            workers[w].reset();
+        }
+    }
+
+    sort(results.begin(), results.end(), lessIndex);
+
+    const size_t resumed = journal ? journal->completed() : 0;
+
+    cout << MSGBLANK << n - resumed << " cases calculated in "
+         << elapsed.count() << " s.\n";
+
+    if (closed && n > resumed) {
+        cout << MSGBLANK << "Closed cycle: " << double(evals) / (n - resumed)
+             << " calculations per case, " << maxEvals << " at most.\n";
+    }
+
+    if (failed > 0) {
+        cout << WARNMSGBLANK << failed << " cases failed"
+             << (closed ? " or not converged" : "") << ", their outputs are NaN.\n";
+    }
+
+    if (results.size() + aggregated != n) {
+        cout << ERRORMSGBLANK << n - results.size() - aggregated << " cases are missing!\n";
+        return false;
+    }
+
+    const bool reported =
+        aggregate ? createAggregateReport(aggregates) : createReport(results);
+
+    // the final state, with the report bytes and no queued jobs
+
+    if (m_metrics) {
+        m_metrics->stop();
+    }
+
+    if (!reported) {
+        return false;
+    }
+
+    if (m_opts->val_store()) {
+
+        uint64_t run = 0;
+
+        if (!Store(m_opts->val_storefile()).append(results, run)) {
+            return false;
+        }
+
+        cout << MSGBLANK << "Stored as run " << run << " in \""
+             << m_opts->val_storefile() << "\".\n\n";
+    }
+
+    if (journal) {
+        journal->remove();
+    }
+
+    return true;
+}
+
+bool Batch::createAggregateReport(const vector<Aggregate> &aggregates) const {
+
+    string reportFilename = m_opts->val_output();
+
+    if (reportFilename.empty()) {
+        reportFilename = string(PRGNAME) + "_aggregate_" + currDateTime() + ".csv";
+    }
+
+    const string tmpFilename = reportFilename + ".tmp";
+
+    ofstream fout(tmpFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    if (!m_opts->val_where().empty()) {
+        fout << "// where " << m_opts->val_where() << "\n";
+    }
+
+    fout << defaultfloat << setprecision(10);
+
+    for (size_t a=0; a<aggregates.size(); a++) {
+        aggregates[a].write(fout);
+    }
+
+    if (m_metrics) {
+        m_metrics->addBytes(fout.tellp());
+    }
+
+    fout.close();
+
+    if (!fout || !replaceFile(tmpFilename, reportFilename)) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << reportFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\" created.\n\n";
+
+    return true;
+}
+
+bool Batch::createReport(const vector<Result> &results) const {
+
+    const size_t shards = m_opts->val_shards();
+    const size_t shard = m_opts->val_shard();
+
+    string reportFilename = m_opts->val_output();
+
+    if (reportFilename.empty()) {
+        if (shards > 1) {
+            reportFilename =
+                string(PRGNAME) + "_shard_" + uintToString(shard) +
+                "-of-" + uintToString(shards) + ".csv";
+        }
+        else {
+            reportFilename =
+                string(PRGNAME) + "_sweep_" + currDateTime() + ".csv";
+        }
+    }
+
+    // the file appears under its name only when it is complete, so the
+    // merge never sees a half-written shard
+
+    const string tmpFilename = reportFilename + ".tmp";
+
+    ofstream fout(tmpFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    if (shards > 1) {
+        fout << "// " << PRGNAME << " partial result\n"
+             << "// version=" << PRGVERSION << "\n"
+             << "// source=" << m_source << "\n"
+             << "// cases=" << m_cases << "\n"
+             << "// shard=" << shard << "/" << shards << "\n";
+    }
+
+    writeResultHeader(fout);
+
+    for (size_t i=0; i<results.size(); i++) {
+        writeResult(fout, results[i]);
+    }
+
+    if (m_metrics) {
+        m_metrics->addBytes(fout.tellp());
+    }
+
+    fout.close();
+
+    if (!fout || !replaceFile(tmpFilename, reportFilename)) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << reportFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\" created.\n\n";
+
+    return true;
+}
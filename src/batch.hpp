@@ -0,0 +1,61 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: batch.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "conf.hpp"
+#include "opts.hpp"
+#include "result.hpp"
+#include "metrics.hpp"
+#include "aggregate.hpp"
+
+// Multi-case run over the cases of a sweep or a table. A shard k of N
+// calculates the cases k-1, k-1+N, k-1+2N, ... and writes the partial
+// result file, which is self-describing for the merge.
+class Batch {
+
+public:
+
+    Batch(const std::shared_ptr<Conf> &conf,
+          const std::shared_ptr<Opts> &opts);
+
+    bool run();
+
+private:
+
+    bool createReport(const std::vector<Result> &) const;
+    bool createAggregateReport(const std::vector<Aggregate> &) const;
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+
+    std::string m_source;
+    size_t      m_cases = 0;
+
+    std::unique_ptr<Metrics> m_metrics;
+
+};
+
+#endif // BATCH_HPP
@@ -23,6 +23,7 @@
 #include "prgid.hpp"
 #include "conf.hpp"
 #include "auxf.hpp"
+#include "cycle.hpp"
 
 #include <iostream>
 #include <fstream>
@@ -30,123 +31,244 @@
 #include <string>
 #include <memory>
 #include <cmath>
+#include <algorithm>
 #include <iomanip>
+#include <thread>
+#include <future>
+#include <functional>
 
 using std::cout;
 using std::vector;
 using std::string;
 using std::ifstream;
 using std::ofstream;
+using std::ostream;
 using std::shared_ptr;
 using std::istreambuf_iterator;
 using std::setw;
 using std::setprecision;
 using std::fixed;
 using std::setfill;
+using std::thread;
+using std::future;
+using std::promise;
+using std::async;
+using std::launch;
+using std::function;
+
+namespace {
+
+// bounds of the near-equal parts of [0, n)
+vector<size_t> splitRange(size_t n, size_t parts) {
+
+    if (parts > n) {
+        parts = (n > 0) ? n : 1;
+    }
+
+    vector<size_t> bounds(parts + 1, 0);
+
+    for (size_t i=0; i<=parts; i++) {
+        bounds[i] = n * i / parts;
+    }
+
+    return bounds;
+}
+
+}
 
 Calc::Calc(const shared_ptr<Conf> &conf) {
     m_conf = conf;
 }
 
 bool Calc::calculate() {
+    return
+        recalculate(INLET);
+}
 
-    const bool   c_boost = m_conf->val_boost();
-    const double c_n     = m_conf->val_n();
-    const double c_i     = m_conf->val_i();
-    const double c_vh    = m_conf->val_vh();
-    const double c_eps   = m_conf->val_eps();
-    const double c_r     = m_conf->val_r();
-    const double c_l     = m_conf->val_l();
-
-    const double c_p0    = m_conf->val_p0();
-    const double c_t0    = m_conf->val_t0();
-    const double c_muv   = m_conf->val_muv();
-
-    const double c_pk    = m_conf->val_pk();
-    const double c_iceff = m_conf->val_iceff();
-    const double c_nk    = m_conf->val_nk();
-    const double c_alpha = m_conf->val_alpha();
-    const double c_etav  = m_conf->val_etav();
-    const double c_pr    = m_conf->val_pr();
-    const double c_tr    = m_conf->val_tr();
-    const double c_dt    = m_conf->val_dt();
-
-    const double c_C     = m_conf->val_C();
-    const double c_H     = m_conf->val_H();
-    const double c_O     = m_conf->val_O();
-    const double c_hu    = m_conf->val_hu();
+bool Calc::recalculate(Phase from) {
 
-    const double c_teta  = m_conf->val_teta();
+    // the cycle can not be built of these angles
+    if (!cycleValidAngles(m_conf->val_teta(), m_conf->val_phiz(), m_conf->val_da())) {
+        return false;
+    }
 
-    const double c_n1    = m_conf->val_n1();
-    const double c_n2s   = m_conf->val_n2s();
+    if (from <= INLET) {
+        calcInlet();
+    }
 
-    const double c_phiz  = m_conf->val_phiz();
-    const double c_ksi   = m_conf->val_ksi();
-    const double c_m     = m_conf->val_m();
-    const double c_da    = m_conf->val_da();
+    if (from <= GRID) {
+        calcGrid();
+    }
 
-    // inlet phase calculation
+    if (from <= COMPRESSION &&
+        m_parallel && !m_parareal &&
+        m_conf->val_da() <= PARALLELDAMAX &&
+        threads() > 1) {
 
-    if (c_boost) {
-        m_tk = pow(c_pk / c_p0, (c_nk - 1.0) / c_nk) * (c_t0 + 273.0);
-        m_tks = m_tk - c_iceff * (m_tk - (c_t0 + 273.0));
-        m_pa = ((c_eps - 1.0) * c_etav * kpa_to_kgfcm2(c_pk) * (m_tks + c_dt) / m_tks + kpa_to_kgfcm2(c_pr)) / c_eps;
-        m_gamma = (1.0 / (c_eps - 1.0) / c_etav) * (c_pr / c_pk) * (m_tks / c_tr);
-        m_ta = (m_tks + c_dt + m_gamma * c_tr) / (1.0 + m_gamma);
+        calcParallel();
     }
     else {
-        m_pa = ((c_eps - 1.0) * c_etav * kpa_to_kgfcm2(c_p0) * (c_t0 + c_dt) / c_t0 + kpa_to_kgfcm2(c_pr)) / c_eps;
-        m_gamma = (1.0 / (c_eps - 1.0) / c_etav) * (c_pr / c_p0) * (c_t0 / c_tr);
-        m_ta = (c_t0 + c_dt + m_gamma * c_tr) / (1.0 + m_gamma);
+
+        if (from <= COMPRESSION) {
+            calcCompression();
+        }
+
+        if (from <= FIRE && m_parareal) {
+            calcFireParareal();
+        }
+        else if (from <= FIRE) {
+            calcFire();
+        }
+
+        if (from <= EXPANSION) {
+            calcExpansion();
+        }
     }
 
-    m_l0s = (8.0 / 3.0 * c_C + 8.0 * c_H - c_O) / 0.232;
-    m_l0 = (c_C / 12.0 + c_H / 4.0 - c_O / 32.0) / 0.21;
-    m_va = (848.0 / 10000.0 / c_muv) * (m_ta / m_pa);
+    calcPerformance();
 
-    // compression phase calculation
+    return true;
+}
 
-    double phi = -180;
+bool Calc::calculateClosed(size_t &evals) {
 
-    const double lam = c_r / c_l;
+    const size_t tr = Conf::keyIndex("tr");
 
-    while (phi <= -c_teta) {
+    // Secant iteration on f(tr) = g(tr) - tr, the one-step Anderson
+    // mixing; the slope of g is warm started from the previous closed
+    // cycle of this Calc, so a neighbouring case needs two or three
+    // calculations. The last calculation is the one of the returned tr.
 
-        m_phi_comp.push_back(phi);
+    double x = m_conf->val_tr();
+    double c = m_trSlope;
+    double xp = 0;
+    double fp = 0;
 
-        const double phi_rad = phi * PI / 180.0;
-        const double sigma = (1.0 + 1.0 / lam) - (cos(phi_rad) + 1.0 / lam * pow(1.0 - pow(lam, 2.0) * pow(sin(phi_rad), 2.0), 0.5));
-        m_sigma_comp.push_back(sigma);
+    evals = 0;
 
-        const double psialpha = 1.0 + (c_eps - 1.0) / 2.0 * sigma;
-        m_psialpha_comp.push_back(psialpha);
+    while (evals < CLOSEDMAXEVALS) {
 
-        const double v = m_va / c_eps * psialpha;
-        m_v_comp.push_back(v);
+        m_conf->setValue(tr, x);
+        m_conf->evaluate();
 
-        const double p = m_pa * pow(m_va / v, c_n1);
-        m_p_comp.push_back(p);
+        if (!recalculate(INLET)) {
+            return false;
+        }
 
-        const double t = m_ta * pow(m_va / v, c_n1 - 1.0);
-        m_t_comp.push_back(t);
+        evals++;
 
-        phi += c_da;
+        const double gx = cycleResidualTemperature(*m_conf, m_p_exp[m_p_exp.size()-1], m_t_exp[m_t_exp.size()-1]);
+
+        if (!std::isfinite(gx) || gx <= 0) {
+            return false;
+        }
+
+        const double f = gx - x;
+
+        if (fabs(f) <= CLOSEDTOL * gx) {
+            m_trSlope = c;
+            return true;
+        }
+
+        if (evals > 1 && x != xp) {
+            c = 1.0 + (f - fp) / (x - xp);
+            c = std::min(std::max(c, -CLOSEDMAXSLOPE), 1.0 - 1.0 / CLOSEDMAXSLOPE);
+        }
+
+        xp = x;
+        fp = f;
+
+        const double xn = x + f / (1.0 - c);
+
+        x = (std::isfinite(xn) && xn > 0) ? xn : gx;
     }
 
-    // fire phase calculation
+    return false;
+}
+
+Calc::Phase Calc::keyPhase(size_t key) {
+
+    // the first phase that reads the key, in the order of Conf::key()
+    static const Phase phases[CONFFIELDS] = {
+        INLET, PERFORMANCE, PERFORMANCE, PERFORMANCE, INLET, COMPRESSION, COMPRESSION,
+        INLET, INLET, INLET,
+        INLET, INLET, INLET, FIRE, INLET, INLET, INLET, INLET,
+        INLET, INLET, INLET, FIRE,
+        GRID,
+        COMPRESSION, EXPANSION,
+        GRID, FIRE, FIRE, GRID
+    };
+
+    return
+        (key < CONFFIELDS) ? phases[key] : INLET;
+}
+
+void Calc::setParallel(bool parallel) {
+    m_parallel = parallel;
+}
+
+void Calc::setThreads(size_t threads) {
+    m_threads = threads;
+}
+
+size_t Calc::threads() const {
+    return
+        (m_threads > 0) ? m_threads : std::max(thread::hardware_concurrency(), 1u);
+}
+
+void Calc::setParareal(bool parareal) {
+    m_parareal = parareal;
+}
+
+void Calc::calcInlet() {
+    cycleInlet(*m_conf, m_inlet);
+}
+
+void Calc::calcGrid() {
+
+    const double c_teta = m_conf->val_teta();
+    const double c_phiz = m_conf->val_phiz();
+    const double c_da   = m_conf->val_da();
 
-    const double qz = c_ksi * c_hu / (1.0 + m_gamma) / c_alpha / m_l0s;
-    const double beta0max = 1.0 + (c_H / 4.0 + c_O / 32.0) / c_alpha / m_l0;
-    const double betamax = (beta0max + m_gamma) / (1.0 + m_gamma);
+    // the angles are accumulated exactly as the phases always did,
+    // so both calculation modes give the same points
 
-    const double phi_fire_max = c_phiz - c_teta;
+    double phi = -180;
+
+    m_phi_comp.clear();
+
+    while (phi <= -c_teta) {
+        m_phi_comp.push_back(phi);
+        phi += c_da;
+    }
 
     phi -= c_da;
-    const double phi_start = phi;
     const size_t vector_size = c_phiz / c_da + 1;
 
     m_phi_fire.resize(vector_size, 0);
+
+    for (size_t i=0; i<vector_size; i++) {
+        m_phi_fire[i] = phi;
+        phi += c_da;
+    }
+
+    phi = m_phi_fire[m_phi_fire.size()-1] + c_da;
+
+    m_phi_exp.clear();
+
+    while (phi <= 180.0) {
+        m_phi_exp.push_back(phi);
+        phi += c_da;
+    }
+
+    const size_t comp_size = m_phi_comp.size();
+
+    m_sigma_comp.resize(comp_size, 0);
+    m_psialpha_comp.resize(comp_size, 0);
+    m_v_comp.resize(comp_size, 0);
+    m_p_comp.resize(comp_size, 0);
+    m_t_comp.resize(comp_size, 0);
+
     m_x_fire.resize(vector_size, 0);
     m_w0_fire.resize(vector_size, 0);
     m_beta_fire.resize(vector_size, 0);
@@ -158,127 +280,354 @@ bool Calc::calculate() {
     m_p_fire.resize(vector_size, 0);
     m_t_fire.resize(vector_size, 0);
 
-    const double py = m_p_comp[m_p_comp.size()-1];
-    const double ty = m_t_comp[m_t_comp.size()-1];
-    const double k_ty = ty / py / m_psialpha_comp[m_psialpha_comp.size()-1];
+    const size_t exp_size = m_phi_exp.size();
 
-    for (size_t i=0; i<vector_size; i++) {
+    m_sigma_exp.resize(exp_size, 0);
+    m_psialpha_exp.resize(exp_size, 0);
+    m_v_exp.resize(exp_size, 0);
+    m_p_exp.resize(exp_size, 0);
+    m_t_exp.resize(exp_size, 0);
+}
 
-        m_phi_fire[i] = phi;
+void Calc::calcCompression() {
+    calcCompressionRange(0, m_phi_comp.size());
+}
+
+void Calc::calcCompressionRange(size_t from, size_t to) {
+
+    const double c_eps = m_conf->val_eps();
+    const double c_n1  = m_conf->val_n1();
+    const double lam   = m_conf->val_r() / m_conf->val_l();
+
+    cycleKinematics(
+        m_phi_comp.data() + from, to - from,
+        lam, c_eps, m_inlet.va,
+        m_sigma_comp.data() + from, m_psialpha_comp.data() + from, m_v_comp.data() + from
+        );
+
+    cyclePolytrope(
+        m_v_comp.data() + from, to - from,
+        m_inlet.pa, m_inlet.ta, m_inlet.va, c_n1,
+        m_p_comp.data() + from, m_t_comp.data() + from
+        );
+}
 
-        const double phi_rel = phi + c_teta;
+void Calc::calcFire() {
+    calcFireKinematics(0, m_phi_fire.size());
+    calcFireRecurrence(0, m_phi_fire.size());
+}
+
+void Calc::calcFireKinematics(size_t from, size_t to) {
+
+    const double c_eps   = m_conf->val_eps();
+    const double c_teta  = m_conf->val_teta();
+    const double c_phiz  = m_conf->val_phiz();
+    const double c_m     = m_conf->val_m();
+    const double lam     = m_conf->val_r() / m_conf->val_l();
 
-        m_x_fire[i] = 1.0 - pow(E, -6.908 * pow(phi_rel / c_phiz, c_m + 1.0));
-        m_w0_fire[i] = 6.908 * (c_m + 1.0) * pow(phi_rel / c_phiz, c_m) * pow(E, -6.908 * pow(phi_rel / c_phiz, c_m + 1.0));
-        m_beta_fire[i] = 1.0 + (betamax - 1.0) * m_x_fire[i];
+    const double betamax = cycleBetamax(*m_conf, m_inlet);
 
-        const double phi_rad = phi * PI / 180.0;
+    cycleBurn(
+        m_phi_fire.data() + from, to - from,
+        c_teta, c_phiz, c_m, betamax,
+        m_x_fire.data() + from, m_w0_fire.data() + from, m_beta_fire.data() + from
+        );
+
+    cycleKinematics(
+        m_phi_fire.data() + from, to - from,
+        lam, c_eps, m_inlet.va,
+        m_sigma_fire.data() + from, m_psialpha_fire.data() + from, m_v_fire.data() + from
+        );
+}
+
+void Calc::calcFireRecurrence(size_t from, size_t to) {
+
+    const FireParams fp = calcFireParams();
+
+    cycleFire(
+        from, to, fp,
+        m_x_fire.data(), m_psialpha_fire.data(), m_beta_fire.data(),
+        m_k_fire.data(), m_ks_fire.data(), m_p_fire.data(), m_t_fire.data()
+        );
+}
 
-        m_sigma_fire[i] = (1.0 + 1.0 / lam) - (cos(phi_rad) + 1.0 / lam * pow(1.0 - pow(lam, 2.0) * pow(sin(phi_rad), 2.0), 0.5));
-        m_psialpha_fire[i] = 1.0 + (c_eps - 1.0) / 2.0 * m_sigma_fire[i];
-        m_v_fire[i] = m_va / c_eps * m_psialpha_fire[i];
+void Calc::calcFireParareal() {
 
-        if (i == 0) {
-            m_k_fire[i] = 1.259 + 76.7 / ty - (0.005 + 0.0372 / c_alpha) * m_x_fire[i];
-            m_ks_fire[i] = (m_k_fire[i] + 1.0) / (m_k_fire[i] - 1.0);
-            m_p_fire[i] = py;
-            m_t_fire[i] = ty;
-            phi += c_da;
-            continue;
+    // The slices of the fire phase get their kinematics and then their
+    // fine recurrences in parallel. The start of every slice is predicted
+    // by the coarse recurrence and corrected by the parareal update
+    //   u[j+1] = G(u[j]) + F(u_old[j]) - G(u_old[j])
+    // until it stops changing; the slice j is exact after j iterations,
+    // so the slices whose starts did not change are not calculated again.
+
+    const size_t n = m_phi_fire.size();
+    const vector<size_t> bounds = splitRange(n, PARAREALSLICES);
+    const size_t slices = bounds.size() - 1;
+
+    // the slices of the list split among the threads
+    const auto parallel = [&](const vector<size_t> &list, const function<void(size_t)> &work) {
+
+        const vector<size_t> parts = splitRange(list.size(), threads());
+        vector<future<void>> tasks;
+
+        for (size_t p=1; p<parts.size(); p++) {
+            tasks.push_back(async(launch::async, [&, p]() {
+                for (size_t i=parts[p-1]; i<parts[p]; i++) {
+                    work(list[i]);
+                }
+            }));
         }
 
-        m_k_fire[i] = 1.259 + 76.7 / m_t_fire[i-1] - (0.005 + 0.0372 / c_alpha) * ((m_x_fire[i-1] + m_x_fire[i]) / 2.0);
+        for (size_t p=0; p<tasks.size(); p++) {
+            tasks[p].get();
+        }
+    };
 
-        const double ks = (m_k_fire[i-1] + m_k_fire[i]) / 2.0;
-        m_ks_fire[i] = (ks + 1.0) / (ks - 1.0);
+    vector<size_t> todo(slices);
 
-        m_p_fire[i] = (0.0854 * c_eps / m_va * qz * (m_x_fire[i] - m_x_fire[i-1]) + m_p_fire[i-1] * (m_ks_fire[i] * m_psialpha_fire[i-1] - m_psialpha_fire[i])) / (m_ks_fire[i] * m_psialpha_fire[i] - m_psialpha_fire[i-1]);
-        m_t_fire[i] = k_ty * m_p_fire[i] * m_psialpha_fire[i] / ((m_beta_fire[i-1] + m_beta_fire[i]) / 2.0);
+    for (size_t j=0; j<slices; j++) {
+        todo[j] = j;
+    }
 
-        //
+    parallel(todo, [&](size_t j) {
+        calcFireKinematics(bounds[j], bounds[j+1]);
+    });
 
-        phi += c_da;
+    const FireParams fp = calcFireParams();
+
+    const double *x = m_x_fire.data();
+    const double *psialpha = m_psialpha_fire.data();
+    const double *beta = m_beta_fire.data();
+
+    const size_t stride = std::max(size_t(PARAREALDA / m_conf->val_da() + 0.5), size_t(1));
+
+    // the states (k, p, t) at the starts of the slices
+    vector<double> u(slices * 3);
+    // and at their ends by the fine and the coarse recurrences
+    vector<double> f(slices * 3);
+    vector<double> g(slices * 3);
+
+    cycleFireFirst(fp, x[0], u[0], m_ks_fire[0], u[1], u[2]);
+
+    for (size_t j=0; j+1<slices; j++) {
+
+        g[j*3] = u[j*3]; g[j*3+1] = u[j*3+1]; g[j*3+2] = u[j*3+2];
+
+        cycleFireCoarse(bounds[j], bounds[j+1], stride, fp, x, psialpha, beta,
+                        g[j*3], g[j*3+1], g[j*3+2]);
+
+        u[(j+1)*3] = g[j*3]; u[(j+1)*3+1] = g[j*3+1]; u[(j+1)*3+2] = g[j*3+2];
     }
 
-    // expansion phase calculation
+    m_pararealIterations = 0;
 
-    phi = m_phi_fire[m_phi_fire.size()-1] + c_da;
-    const double pz = m_p_fire[m_p_fire.size()-1];
-    const double tz = m_t_fire[m_t_fire.size()-1];
-    const double vz = m_v_fire[m_v_fire.size()-1];
+    while (!todo.empty()) {
 
-    while (phi <= 180.0) {
+        parallel(todo, [&](size_t j) {
 
-        m_phi_exp.push_back(phi);
+            const size_t b = bounds[j];
+            const size_t e = bounds[j+1];
 
-        const double phi_rad = phi * PI / 180.0;
-        const double sigma = (1.0 + 1.0 / lam) - (cos(phi_rad) + 1.0 / lam * pow(1.0 - pow(lam, 2.0) * pow(sin(phi_rad), 2.0), 0.5));
-        m_sigma_exp.push_back(sigma);
+            m_k_fire[b] = u[j*3];
+            m_p_fire[b] = u[j*3+1];
+            m_t_fire[b] = u[j*3+2];
 
-        const double psialpha = 1.0 + (c_eps - 1.0) / 2.0 * sigma;
-        m_psialpha_exp.push_back(psialpha);
+            cycleFire(
+                b + 1, e, fp, x, psialpha, beta,
+                m_k_fire.data(), m_ks_fire.data(), m_p_fire.data(), m_t_fire.data()
+                );
 
-        const double v = m_va / c_eps * psialpha;
-        m_v_exp.push_back(v);
+            if (e < n) {
+                cycleFireStep(
+                    fp,
+                    x[e-1], x[e], psialpha[e-1], psialpha[e],
+                    beta[e-1], beta[e], m_k_fire[e-1], m_p_fire[e-1], m_t_fire[e-1],
+                    f[j*3], m_ks_fire[e], f[j*3+1], f[j*3+2]
+                    );
+            }
+        });
 
-        const double p = pz * pow(vz / v, c_n2s);
-        m_p_exp.push_back(p);
+        m_pararealIterations++;
 
-        const double t = tz * pow(vz / v, c_n2s - 1.0);
-        m_t_exp.push_back(t);
+        const size_t first = todo[0];
+        double change = 0;
 
-        phi += c_da;
+        todo.clear();
+
+        for (size_t j=first; j+1<slices; j++) {
+
+            double gn[3] = {u[j*3], u[j*3+1], u[j*3+2]};
+            bool moved = false;
+
+            cycleFireCoarse(bounds[j], bounds[j+1], stride, fp, x, psialpha, beta,
+                            gn[0], gn[1], gn[2]);
+
+            for (size_t c=0; c<3; c++) {
+
+                const double un = f[j*3+c] + (gn[c] - g[j*3+c]);
+                const double old = u[(j+1)*3+c];
+
+                change = std::max(change, fabs(un - old) / std::max(fabs(un), 1e-300));
+                moved = moved || un != old;
+
+                u[(j+1)*3+c] = un;
+                g[j*3+c] = gn[c];
+            }
+
+            // the slices after a moved start are calculated again
+            if (moved || !todo.empty()) {
+                todo.push_back(j + 1);
+            }
+        }
+
+        if (change <= PARAREALTOL) {
+            break;
+        }
     }
+}
 
-    // indicated parameters calculation
+FireParams Calc::calcFireParams() {
 
-    const double lay = 10000.0 * m_va / (c_eps * (c_n1 - 1.0)) * (m_pa * c_eps - py * m_psialpha_comp[m_psialpha_comp.size()-1]);
-    const double lzb = 10000.0 * m_va / (c_eps * (c_n2s - 1.0)) * (pz * m_psialpha_fire[m_psialpha_fire.size()-1] - m_p_exp[m_p_exp.size()-1] * c_eps);
+    m_qz = cycleQz(*m_conf, m_inlet);
 
-    double sum = 0;
+    FireParams fp;
 
-    for (size_t i=1; i<m_p_fire.size(); i++) {
-        sum += ((m_p_fire[i-1] + m_p_fire[i]) / 2.0) * (m_psialpha_fire[i] - m_psialpha_fire[i-1]);
+    fp.eps   = m_conf->val_eps();
+    fp.va    = m_inlet.va;
+    fp.alpha = m_conf->val_alpha();
+    fp.qz    = m_qz;
+    fp.py    = m_p_comp[m_p_comp.size()-1];
+    fp.ty    = m_t_comp[m_t_comp.size()-1];
+    fp.k_ty  = fp.ty / fp.py / m_psialpha_comp[m_psialpha_comp.size()-1];
+
+    return fp;
+}
+
+void Calc::calcExpansion() {
+    calcExpansionKinematics(0, m_phi_exp.size());
+    calcExpansionPolytrope(0, m_phi_exp.size());
+}
+
+void Calc::calcExpansionKinematics(size_t from, size_t to) {
+
+    const double c_eps = m_conf->val_eps();
+    const double lam   = m_conf->val_r() / m_conf->val_l();
+
+    cycleKinematics(
+        m_phi_exp.data() + from, to - from,
+        lam, c_eps, m_inlet.va,
+        m_sigma_exp.data() + from, m_psialpha_exp.data() + from, m_v_exp.data() + from
+        );
+}
+
+void Calc::calcExpansionPolytrope(size_t from, size_t to) {
+
+    const double c_n2s = m_conf->val_n2s();
+
+    const double pz = m_p_fire[m_p_fire.size()-1];
+    const double tz = m_t_fire[m_t_fire.size()-1];
+    const double vz = m_v_fire[m_v_fire.size()-1];
+
+    cyclePolytrope(
+        m_v_exp.data() + from, to - from,
+        pz, tz, vz, c_n2s,
+        m_p_exp.data() + from, m_t_exp.data() + from
+        );
+}
+
+void Calc::calcParallel() {
+
+    // Only the fire recurrence is serial. It runs on the calling thread,
+    // the other threads of the budget compute a part of the compression
+    // phase and of the angle dependent parts of the fire and expansion
+    // phases each; the recurrence waits for each fire part just before it
+    // needs it.
+
+    const size_t helpers = threads() - 1;
+
+    const vector<size_t> comp_bounds = splitRange(m_phi_comp.size(), helpers);
+    const vector<size_t> fire_bounds = splitRange(m_phi_fire.size(), helpers);
+    const vector<size_t> exp_bounds = splitRange(m_phi_exp.size(), helpers);
+
+    vector<promise<void>> comp_done(helpers);
+    vector<promise<void>> fire_done(helpers);
+    vector<future<void>> tasks;
+
+    for (size_t p=0; p<helpers; p++) {
+        tasks.push_back(async(launch::async, [&, p]() {
+            if (p + 1 < comp_bounds.size()) {
+                calcCompressionRange(comp_bounds[p], comp_bounds[p+1]);
+            }
+            comp_done[p].set_value();
+            if (p + 1 < fire_bounds.size()) {
+                calcFireKinematics(fire_bounds[p], fire_bounds[p+1]);
+            }
+            fire_done[p].set_value();
+            if (p + 1 < exp_bounds.size()) {
+                calcExpansionKinematics(exp_bounds[p], exp_bounds[p+1]);
+            }
+        }));
     }
 
-    const double lyz = 10000.0 * m_va / c_eps * sum;
+    for (size_t p=0; p<helpers; p++) {
+        comp_done[p].get_future().wait();
+    }
 
-    m_li = lay + lzb + lyz;
-    m_pi = c_eps / 10000.0 / (c_eps - 1.0) * m_li / m_va;
-    m_etai = c_ksi * m_li / 427 / qz;
-    m_gi = 1000.0 * 632 / c_hu / m_etai;
+    for (size_t i=1; i<fire_bounds.size(); i++) {
+        fire_done[i-1].get_future().wait();
+        calcFireRecurrence(fire_bounds[i-1], fire_bounds[i]);
+    }
 
-    // effective parameters calculation
+    for (size_t p=0; p<helpers; p++) {
+        tasks[p].get();
+    }
+
+    // the polytrope needs the end of the fire phase; the calling thread
+    // takes the last part
 
-    const double cm = c_r * 0.001 * 2.0 * c_n / 30.0;
+    const vector<size_t> poly_bounds = splitRange(m_phi_exp.size(), helpers + 1);
+    const size_t last = poly_bounds.size() - 1;
 
-    double a = 0;
-    double b = 0;
+    tasks.clear();
 
-    if (c_i <= 6) {
-        a = 0.9;
-        b = 0.12;
+    for (size_t i=1; i<last; i++) {
+        tasks.push_back(async(launch::async, &Calc::calcExpansionPolytrope,
+                              this, poly_bounds[i-1], poly_bounds[i]));
     }
-    else if (c_i <= 8 ) {
-        a = 0.7;
-        b = 0.12;
+
+    calcExpansionPolytrope(poly_bounds[last-1], poly_bounds[last]);
+
+    for (size_t i=0; i<tasks.size(); i++) {
+        tasks[i].get();
     }
-    else {
-        a = 0.3;
-        b = 0.12;
+}
+
+void Calc::calcPerformance() {
+
+    double sum = 0;
+
+    for (size_t i=1; i<m_p_fire.size(); i++) {
+        sum += ((m_p_fire[i-1] + m_p_fire[i]) / 2.0) * (m_psialpha_fire[i] - m_psialpha_fire[i-1]);
     }
 
-    m_pm = a + b * cm;
-    m_pe = m_pi - m_pm;
-    m_etam = m_pe / m_pi;
-    m_etae = m_etai * m_etam;
-    m_ge = 1000.0 * 632 / c_hu / m_etae;
+    cyclePerformance(
+        *m_conf, m_inlet, m_qz,
+        m_p_comp[m_p_comp.size()-1], m_psialpha_comp[m_psialpha_comp.size()-1],
+        m_p_fire[m_p_fire.size()-1], m_psialpha_fire[m_psialpha_fire.size()-1],
+        m_p_exp[m_p_exp.size()-1], sum, m_perf
+        );
+}
 
-    m_Ne = m_pe * c_vh * c_n / 225.0 / 4.0;
+void Calc::outputs(double *out) const {
+    cycleOutputs(m_perf, m_p_fire[0], maxValue(m_p_fire), out);
+}
 
-    //
+double Calc::cost(const Conf &conf) {
 
-    return true;
+    // every point costs a few pow() calls, the fire points about twice
+    // as much as the others
+    return
+        (360.0 + conf.val_phiz()) / conf.val_da();
 }
 
 bool Calc::createReport() const {
@@ -331,43 +680,66 @@ bool Calc::createReport() const {
         return false;
     }
 
-    fout << PRGNAME << "\nv" << PRGVERSION << "\n\n";
+    writeReport(fout);
 
-    fout << "Results of INLET phase calculation\n\n";
-    fout << "Tk    = " << fixed << setprecision(1) << m_tk  - 273.0        << " degC\n";
-    fout << "Tks   = " << fixed << setprecision(1) << m_tks - 273.0        << " degC\n";
-    fout << "Pa    = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_pa)  << " kPa\n";
-    fout << "gamma = " << fixed << setprecision(4) << m_gamma              << "\n";
-    fout << "Ta    = " << fixed << setprecision(1) << m_ta - 273.0         << " degC\n";
-    fout << "L0s   = " << fixed << setprecision(3) << m_l0s                << " kg/kg\n";
-    fout << "L0    = " << fixed << setprecision(3) << m_l0                 << " kgmol/kg\n";
-    fout << "va    = " << fixed << setprecision(3) << m_va                 << " m3/kg\n\n";
+    fout.close();
+
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\"created.\n\n";
 
-    fout << "Results of COMPRESSION phase calculation\n\n";
-    fout << setw(10) << "phi[deg]"
+    //
+
+    cout << "Cylinder pressure\n\n";
+    cout << "P_comp_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_p_fire[0]) << " kPa\n";
+    cout << "P_fire_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(maxValue(m_p_fire)) << " kPa\n\n";
+
+    cout << "EFFECTIVE parameters\n\n";
+    cout << "pe   = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_perf.pe) << " kPa\n";
+    cout << "etae = " << fixed << setprecision(3) << m_perf.etae              << "\n";
+    cout << "Ne   = " << fixed << setprecision(1) << m_perf.Ne / 1.36         << " kW\n";
+    cout << "ge   = " << fixed << setprecision(1) << m_perf.ge * 1.36         << " g/kWh\n\n";
+
+    return true;
+}
+
+void Calc::writeReport(ostream &out) const {
+
+    out << PRGNAME << "\nv" << PRGVERSION << "\n\n";
+
+    out << "Results of INLET phase calculation\n\n";
+    out << "Tk    = " << fixed << setprecision(1) << m_inlet.tk  - 273.0        << " degC\n";
+    out << "Tks   = " << fixed << setprecision(1) << m_inlet.tks - 273.0        << " degC\n";
+    out << "Pa    = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_inlet.pa)  << " kPa\n";
+    out << "gamma = " << fixed << setprecision(4) << m_inlet.gamma              << "\n";
+    out << "Ta    = " << fixed << setprecision(1) << m_inlet.ta - 273.0         << " degC\n";
+    out << "L0s   = " << fixed << setprecision(3) << m_inlet.l0s                << " kg/kg\n";
+    out << "L0    = " << fixed << setprecision(3) << m_inlet.l0                 << " kgmol/kg\n";
+    out << "va    = " << fixed << setprecision(3) << m_inlet.va                 << " m3/kg\n\n";
+
+    out << "Results of COMPRESSION phase calculation\n\n";
+    out << setw(10) << "phi[deg]"
          << setw(10) << "sigma"
          << setw(10) << "psialpha"
          << setw(10) << "v[m3/kg]"
          << setw(10) << "p[kPa]"
          << setw(10) << "t[degC]\n";
-    fout << setfill('-') << setw(60);
-    fout << "\n";
-    fout << setfill(' ');
+    out << setfill('-') << setw(60);
+    out << "\n";
+    out << setfill(' ');
 
     for (size_t i=0; i<m_phi_comp.size()-1; i++) {
-        fout << setw(10) << setprecision(1) << m_phi_comp[i]
-             << setw(10) << setprecision(4) << m_sigma_comp[i]
-             << setw(10) << setprecision(4) << m_psialpha_comp[i]
-             << setw(10) << setprecision(4) << m_v_comp[i]
-             << setw(10) << setprecision(1) << kgfcm2_to_kpa(m_p_comp[i])
-             << setw(9)  << setprecision(1) << m_t_comp[i] - 273.0;
-        fout << "\n";
+        out << setw(10) << setprecision(1) << m_phi_comp[i]
+            << setw(10) << setprecision(4) << m_sigma_comp[i]
+            << setw(10) << setprecision(4) << m_psialpha_comp[i]
+            << setw(10) << setprecision(4) << m_v_comp[i]
+            << setw(10) << setprecision(1) << kgfcm2_to_kpa(m_p_comp[i])
+            << setw(9)  << setprecision(1) << m_t_comp[i] - 273.0;
+        out << "\n";
     }
 
-    fout << "\n";
+    out << "\n";
 
-    fout << "Results of FIRE phase calculation\n\n";
-    fout << setw(10) << "phi[deg]"
+    out << "Results of FIRE phase calculation\n\n";
+    out << setw(10) << "phi[deg]"
          << setw(10) << "x"
          << setw(10) << "w0"
          << setw(10) << "beta"
@@ -378,81 +750,63 @@ bool Calc::createReport() const {
          << setw(10) << "Ks"
          << setw(10) << "p[kPa]"
          << setw(10) << "t[degC]\n";
-    fout << setfill('-') << setw(110);
-    fout << "\n";
-    fout << setfill(' ');
+    out << setfill('-') << setw(110);
+    out << "\n";
+    out << setfill(' ');
 
     for (size_t i=0; i<m_phi_fire.size(); i++) {
-        fout << setw(10) << setprecision(1) << m_phi_fire[i]
-             << setw(10) << setprecision(4) << m_x_fire[i]
-             << setw(10) << setprecision(4) << m_w0_fire[i]
-             << setw(10) << setprecision(3) << m_beta_fire[i]
-             << setw(10) << setprecision(4) << m_sigma_fire[i]
-             << setw(10) << setprecision(4) << m_psialpha_fire[i]
-             << setw(10) << setprecision(4) << m_v_fire[i]
-             << setw(10) << setprecision(3) << m_k_fire[i]
-             << setw(10) << setprecision(3) << m_ks_fire[i]
-             << setw(10) << setprecision(1) << kgfcm2_to_kpa(m_p_fire[i])
-             << setw(9)  << setprecision(1) << m_t_fire[i] - 273.0;
-        fout << "\n";
+        out << setw(10) << setprecision(1) << m_phi_fire[i]
+            << setw(10) << setprecision(4) << m_x_fire[i]
+            << setw(10) << setprecision(4) << m_w0_fire[i]
+            << setw(10) << setprecision(3) << m_beta_fire[i]
+            << setw(10) << setprecision(4) << m_sigma_fire[i]
+            << setw(10) << setprecision(4) << m_psialpha_fire[i]
+            << setw(10) << setprecision(4) << m_v_fire[i]
+            << setw(10) << setprecision(3) << m_k_fire[i]
+            << setw(10) << setprecision(3) << m_ks_fire[i]
+            << setw(10) << setprecision(1) << kgfcm2_to_kpa(m_p_fire[i])
+            << setw(9)  << setprecision(1) << m_t_fire[i] - 273.0;
+        out << "\n";
     }
 
-    fout << "\n";
+    out << "\n";
 
-    fout << "Results of EXPANSION phase calculation\n\n";
-    fout << setw(10) << "phi[deg]"
+    out << "Results of EXPANSION phase calculation\n\n";
+    out << setw(10) << "phi[deg]"
          << setw(10) << "sigma"
          << setw(10) << "psialpha"
          << setw(10) << "v[m3/kg]"
          << setw(10) << "p[kPa]"
          << setw(10) << "t[degC]\n";
-    fout << setfill('-') << setw(60);
-    fout << "\n";
-    fout << setfill(' ');
+    out << setfill('-') << setw(60);
+    out << "\n";
+    out << setfill(' ');
 
     for (size_t i=0; i<m_phi_exp.size(); i++) {
-        fout << setw(10) << setprecision(1) << m_phi_exp[i]
-             << setw(10) << setprecision(4) << m_sigma_exp[i]
-             << setw(10) << setprecision(4) << m_psialpha_exp[i]
-             << setw(10) << setprecision(4) << m_v_exp[i]
-             << setw(10) << setprecision(1) << kgfcm2_to_kpa(m_p_exp[i])
-             << setw(9)  << setprecision(1) << m_t_exp[i] - 273.0;
-        fout << "\n";
+        out << setw(10) << setprecision(1) << m_phi_exp[i]
+            << setw(10) << setprecision(4) << m_sigma_exp[i]
+            << setw(10) << setprecision(4) << m_psialpha_exp[i]
+            << setw(10) << setprecision(4) << m_v_exp[i]
+            << setw(10) << setprecision(1) << kgfcm2_to_kpa(m_p_exp[i])
+            << setw(9)  << setprecision(1) << m_t_exp[i] - 273.0;
+        out << "\n";
     }
 
-    fout << "\n";
-
-    fout << "Cylinder pressure\n\n";
-    fout << "P_comp_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_p_fire[0]) << " kPa\n";
-    fout << "P_fire_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(maxValue(m_p_fire)) << " kPa\n\n";
+    out << "\n";
 
-    fout << "INDICATED parameters\n\n";
-    fout << "li   = " << fixed << setprecision(1) << kgfmkg_to_j(m_li)   << " J\n";
-    fout << "pi   = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_pi) << " kPa\n";
-    fout << "etai = " << fixed << setprecision(3) << m_etai              << "\n";
-    fout << "gi   = " << fixed << setprecision(1) << m_gi * 1.36         << " g/kWh\n\n";
+    out << "Cylinder pressure\n\n";
+    out << "P_comp_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_p_fire[0]) << " kPa\n";
+    out << "P_fire_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(maxValue(m_p_fire)) << " kPa\n\n";
 
-    fout << "EFFECTIVE parameters\n\n";
-    fout << "pe   = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_pe) << " kPa\n";
-    fout << "etae = " << fixed << setprecision(3) << m_etae              << "\n";
-    fout << "Ne   = " << fixed << setprecision(1) << m_Ne / 1.36         << " kW\n";
-    fout << "ge   = " << fixed << setprecision(1) << m_ge * 1.36         << " g/kWh\n\n";
+    out << "INDICATED parameters\n\n";
+    out << "li   = " << fixed << setprecision(1) << kgfmkg_to_j(m_perf.li)   << " J\n";
+    out << "pi   = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_perf.pi) << " kPa\n";
+    out << "etai = " << fixed << setprecision(3) << m_perf.etai              << "\n";
+    out << "gi   = " << fixed << setprecision(1) << m_perf.gi * 1.36         << " g/kWh\n\n";
 
-    fout.close();
-
-    cout << MSGBLANK << "Report file \"" << reportFilename << "\"created.\n\n";
-
-    //
-
-    cout << "Cylinder pressure\n\n";
-    cout << "P_comp_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_p_fire[0]) << " kPa\n";
-    cout << "P_fire_max = " << fixed << setprecision(1) << kgfcm2_to_kpa(maxValue(m_p_fire)) << " kPa\n\n";
-
-    cout << "EFFECTIVE parameters\n\n";
-    cout << "pe   = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_pe) << " kPa\n";
-    cout << "etae = " << fixed << setprecision(3) << m_etae              << "\n";
-    cout << "Ne   = " << fixed << setprecision(1) << m_Ne / 1.36         << " kW\n";
-    cout << "ge   = " << fixed << setprecision(1) << m_ge * 1.36         << " g/kWh\n\n";
-
-    return true;
+    out << "EFFECTIVE parameters\n\n";
+    out << "pe   = " << fixed << setprecision(1) << kgfcm2_to_kpa(m_perf.pe) << " kPa\n";
+    out << "etae = " << fixed << setprecision(3) << m_perf.etae              << "\n";
+    out << "Ne   = " << fixed << setprecision(1) << m_perf.Ne / 1.36         << " kW\n";
+    out << "ge   = " << fixed << setprecision(1) << m_perf.ge * 1.36         << " g/kWh\n\n";
 }
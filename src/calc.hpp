@@ -23,8 +23,10 @@
 
 #include <vector>
 #include <memory>
+#include <ostream>
 
 #include "conf.hpp"
+#include "cycle.hpp"
 
 class Calc {
 
@@ -32,21 +34,88 @@ public:
 
     Calc(const std::shared_ptr<Conf> &conf);
 
+    // Phases of the calculation in their order. A phase depends on the
+    // keys it reads and on all the phases before it.
+    enum Phase { INLET, GRID, COMPRESSION, FIRE, EXPANSION, PERFORMANCE };
+
+    // the first phase which reads the key of the configuration
+    static Phase keyPhase(size_t key);
+
     bool calculate();
+
+    // Calculates again from the given phase on; the phases before it must
+    // have been calculated for the same values of their keys.
+    bool recalculate(Phase from);
+
+    // Closed cycle: tr is not an input but the fixed point of
+    // cycleResidualTemperature(), found by the secant iteration from the
+    // current tr of the configuration, which gets the solution. evals
+    // gets the number of the calculations made.
+    bool calculateClosed(size_t &evals);
+
+    // slope of the iteration of the last closed cycle, the warm start of
+    // the next one
+    double trSlope() const { return m_trSlope; }
+    void setTrSlope(double slope) { m_trSlope = slope; }
+
     bool createReport() const;
+    void writeReport(std::ostream &) const;
+
+    // Intra-run parallel mode for fine resolutions (da <= PARALLELDAMAX).
+    // Enabled by default; batch runs disable it since they are already
+    // parallel over the cases.
+    void setParallel(bool);
+
+    // Parareal mode of the fire recurrence: the coarse recurrence over
+    // PARAREALDA steps predicts the states at the bounds of the slices of
+    // the fire phase, the fine recurrences of the slices correct them in
+    // parallel until the states change by no more than PARAREALTOL.
+    void setParareal(bool);
+
+    // threads of the parallel and parareal modes, the calling one
+    // included; all cores by default (0)
+    void setThreads(size_t);
+
+    // of the fine recurrences of the last parareal calculation
+    size_t pararealIterations() const { return m_pararealIterations; }
+
+    // scalar results in the report units, see outputName()
+    void outputs(double *) const;
+
+    // relative cost of the calculation for the scheduler
+    static double cost(const Conf &);
 
 private:
 
+    void calcInlet();
+    void calcGrid();
+    void calcCompression();
+    void calcCompressionRange(size_t, size_t);
+    void calcFire();
+    void calcFireKinematics(size_t, size_t);
+    void calcFireRecurrence(size_t, size_t);
+    void calcFireParareal();
+    FireParams calcFireParams();
+    void calcExpansion();
+    void calcExpansionKinematics(size_t, size_t);
+    void calcExpansionPolytrope(size_t, size_t);
+    void calcParallel();
+    size_t threads() const;
+    void calcPerformance();
+
     std::shared_ptr<Conf> m_conf;
 
-    double m_tk    = 0;
-    double m_tks   = 0;
-    double m_pa    = 0;
-    double m_gamma = 0;
-    double m_ta    = 0;
-    double m_l0s   = 0;
-    double m_l0    = 0;
-    double m_va    = 0;
+    bool m_parallel = true;
+    bool m_parareal = false;
+
+    size_t m_threads = 0;
+
+    size_t m_pararealIterations = 0;
+
+    double m_trSlope = 0; // of the last closed cycle, the warm start
+
+    InletState m_inlet;
+    double     m_qz = 0;
 
     std::vector<double> m_phi_comp;
     std::vector<double> m_sigma_comp;
@@ -74,18 +143,7 @@ private:
     std::vector<double> m_p_exp;
     std::vector<double> m_t_exp;
 
-    double m_li = 0;
-    double m_pi = 0;
-    double m_etai = 0;
-    double m_gi = 0;
-
-    double m_pm = 0;
-    double m_pe = 0;
-    double m_etam = 0;
-    double m_etae = 0;
-    double m_ge = 0;
-
-    double m_Ne = 0;
+    Performance m_perf;
 };
 
 #endif // CALC_HPP
@@ -0,0 +1,217 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: capi.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vibe72.h"
+#include "const.hpp"
+#include "conf.hpp"
+#include "cycle.hpp"
+#include "enginemap.hpp"
+
+#include <new>
+
+struct vibe72_map {
+    EngineMap map;
+};
+
+namespace {
+
+// the configuration on the stack, in the order of Conf::key()
+void makeConf(const vibe72_params &pr, Conf &conf) {
+
+    const double values[CONFFIELDS] = {
+        pr.boost ? 1.0 : 0.0, pr.n, pr.i, pr.vh, pr.eps, pr.r, pr.l,
+        pr.p0, pr.t0, pr.muv,
+        pr.pk, pr.iceff, pr.nk, pr.alpha, pr.etav, pr.pr, pr.tr, pr.dt,
+        pr.C, pr.H, pr.O, pr.hu,
+        pr.teta,
+        pr.n1, pr.n2s,
+        pr.phiz, pr.ksi, pr.m, pr.da
+    };
+
+    for (size_t i=0; i<CONFFIELDS; i++) {
+        conf.setValue(i, values[i]);
+    }
+}
+
+void copyOutputs(const double *out, vibe72_outputs *outputs) {
+    outputs->pe         = out[0];
+    outputs->etae       = out[1];
+    outputs->gi         = out[2];
+    outputs->ge         = out[3];
+    outputs->Ne         = out[4];
+    outputs->P_comp_max = out[5];
+    outputs->P_fire_max = out[6];
+}
+
+}
+
+int vibe72_api_version(void) {
+    return VIBE72_API_VERSION;
+}
+
+int vibe72_sizes_query(double da, double teta, double phiz,
+                       vibe72_sizes *sizes) {
+
+    if (!sizes || !cycleValidAngles(teta, phiz, da)) {
+        return VIBE72_EINVAL;
+    }
+
+    cycleSizes(teta, phiz, da, sizes->comp, sizes->fire, sizes->exp);
+
+    // the last compression point is the first fire point
+    sizes->total = sizes->comp - 1 + sizes->fire + sizes->exp;
+
+    return VIBE72_OK;
+}
+
+int vibe72_calculate(const vibe72_params *params,
+                     vibe72_trace *trace,
+                     vibe72_outputs *outputs) {
+
+    if (!params) {
+        return VIBE72_EINVAL;
+    }
+
+    vibe72_sizes sizes;
+
+    if (vibe72_sizes_query(params->da, params->teta, params->phiz, &sizes) != VIBE72_OK) {
+        return VIBE72_EINVAL;
+    }
+
+    if (trace && sizes.total > trace->capacity) {
+        return VIBE72_ECAPACITY;
+    }
+
+    Conf conf;
+    makeConf(*params, conf);
+
+    double out[CALCOUTPUTS];
+
+    cycleStream(
+        conf,
+        trace ? trace->phi : nullptr,
+        trace ? trace->p : nullptr,
+        trace ? trace->t : nullptr,
+        outputs ? out : nullptr
+        );
+
+    if (outputs) {
+        copyOutputs(out, outputs);
+    }
+
+    return VIBE72_OK;
+}
+
+int vibe72_rt_prepare(double da, double teta, double phiz,
+                      vibe72_rt *rt) {
+
+    if (!rt || vibe72_sizes_query(da, teta, phiz, &rt->sizes) != VIBE72_OK ||
+        rt->sizes.total > VIBE72_RT_MAXPOINTS) {
+        return VIBE72_EINVAL;
+    }
+
+    rt->da = da;
+    rt->teta = teta;
+    rt->phiz = phiz;
+
+    return VIBE72_OK;
+}
+
+int vibe72_rt_calculate(const vibe72_rt *rt,
+                        const vibe72_params *params,
+                        vibe72_trace *trace,
+                        vibe72_outputs *outputs) {
+
+    // only comparisons before the calculation of the fixed length
+
+    if (!rt || !params || params->da != rt->da ||
+        params->teta != rt->teta || params->phiz != rt->phiz) {
+        return VIBE72_EINVAL;
+    }
+
+    if (trace && rt->sizes.total > trace->capacity) {
+        return VIBE72_ECAPACITY;
+    }
+
+    Conf conf;
+    makeConf(*params, conf);
+
+    double out[CALCOUTPUTS];
+
+    cycleStreamSized(
+        conf, rt->sizes.comp, rt->sizes.fire, rt->sizes.exp,
+        trace ? trace->phi : nullptr,
+        trace ? trace->p : nullptr,
+        trace ? trace->t : nullptr,
+        outputs ? out : nullptr
+        );
+
+    if (outputs) {
+        copyOutputs(out, outputs);
+    }
+
+    return VIBE72_OK;
+}
+
+int vibe72_map_open(const char *filename, vibe72_map **map) {
+
+    if (!filename || !map) {
+        return VIBE72_EINVAL;
+    }
+
+    *map = new (std::nothrow) vibe72_map();
+
+    if (!*map || !(*map)->map.open(filename)) {
+        delete *map;
+        *map = nullptr;
+        return VIBE72_EINVAL;
+    }
+
+    return VIBE72_OK;
+}
+
+void vibe72_map_close(vibe72_map *map) {
+    delete map;
+}
+
+size_t vibe72_map_axes(const vibe72_map *map) {
+    return
+        map ? map->map.axes() : 0;
+}
+
+const char *vibe72_map_axis_key(const vibe72_map *map, size_t axis) {
+    return
+        (map && axis < map->map.axes()) ? Conf::key(map->map.axis(axis).key) : nullptr;
+}
+
+int vibe72_map_query(const vibe72_map *map, const double *x,
+                     vibe72_outputs *outputs) {
+
+    if (!map || !x || !outputs) {
+        return VIBE72_EINVAL;
+    }
+
+    double out[CALCOUTPUTS];
+
+    map->map.query(x, out);
+    copyOutputs(out, outputs);
+
+    return VIBE72_OK;
+}
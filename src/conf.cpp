@@ -22,12 +22,16 @@
 #include "const.hpp"
 #include "prgid.hpp"
 #include "auxf.hpp"
+#include "expr.hpp"
 
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <regex>
+#include <memory>
+#include <cstdlib>
+#include <cctype>
 
 using std::cout;
 using std::string;
@@ -36,6 +40,46 @@ using std::ifstream;
 using std::ofstream;
 using std::regex;
 using std::regex_match;
+using std::shared_ptr;
+
+namespace {
+
+const char *const confKeys[CONFFIELDS] = {
+    "boost", "n", "i", "vh", "eps", "r", "l",
+    "p0", "t0", "muv",
+    "pk", "iceff", "nk", "alpha", "etav", "pr", "tr", "dt",
+    "C", "H", "O", "hu",
+    "teta",
+    "n1", "n2s",
+    "phiz", "ksi", "m", "da"
+};
+
+// a number, maybe with spaces around, or nothing (0 as always)
+bool isNumber(const string &s) {
+
+    const char *begin = s.c_str();
+    char *end = nullptr;
+
+    strtod(begin, &end);
+
+    while (*end != '\0' && isspace(static_cast<unsigned char>(*end))) {
+        end++;
+    }
+
+    if (*end != '\0') {
+        return false;
+    }
+
+    for (const char *c=begin; c<end; c++) {
+        if (!isspace(static_cast<unsigned char>(*c))) {
+            return end != begin;
+        }
+    }
+
+    return true;
+}
+
+}
 
 bool Conf::readConfigFile() {
 
@@ -58,14 +102,19 @@ bool Conf::readConfigFile() {
         return false;
     }
 
+    // compiled once, the file is read again on every save in watch mode
+    static const regex comment(COMMENTREGEX);
+
     string s;
     vector<string> elem;
+    shared_ptr<ConfExpr> expr(new ConfExpr());
+    bool ok = true;
 
     while (!fin.eof()) {
 
         getline(fin, s);
 
-        if (regex_match(s, regex(COMMENTREGEX)) || s.empty()) {
+        if (regex_match(s, comment) || s.empty()) {
             continue;
         }
 
@@ -79,35 +128,17 @@ bool Conf::readConfigFile() {
             continue;
         }
 
-        if      ( elem[0] == "boost" ) { m_boost = stringToBool(elem[1]);   }
-        else if ( elem[0] == "n"     ) { m_n     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "i"     ) { m_i     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "vh"    ) { m_vh    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "eps"   ) { m_eps   = stringToDouble(elem[1]); }
-        else if ( elem[0] == "r"     ) { m_r     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "l"     ) { m_l     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "p0"    ) { m_p0    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "t0"    ) { m_t0    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "muv"   ) { m_muv   = stringToDouble(elem[1]); }
-        else if ( elem[0] == "pk"    ) { m_pk    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "iceff" ) { m_iceff = stringToDouble(elem[1]); }
-        else if ( elem[0] == "nk"    ) { m_nk    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "alpha" ) { m_alpha = stringToDouble(elem[1]); }
-        else if ( elem[0] == "etav"  ) { m_etav  = stringToDouble(elem[1]); }
-        else if ( elem[0] == "pr"    ) { m_pr    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "tr"    ) { m_tr    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "dt"    ) { m_dt    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "C"     ) { m_C     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "H"     ) { m_H     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "O"     ) { m_O     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "hu"    ) { m_hu    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "teta"  ) { m_teta  = stringToDouble(elem[1]); }
-        else if ( elem[0] == "n1"    ) { m_n1    = stringToDouble(elem[1]); }
-        else if ( elem[0] == "n2s"   ) { m_n2s   = stringToDouble(elem[1]); }
-        else if ( elem[0] == "phiz"  ) { m_phiz  = stringToDouble(elem[1]); }
-        else if ( elem[0] == "ksi"   ) { m_ksi   = stringToDouble(elem[1]); }
-        else if ( elem[0] == "m"     ) { m_m     = stringToDouble(elem[1]); }
-        else if ( elem[0] == "da"    ) { m_da    = stringToDouble(elem[1]); }
+        const size_t idx = keyIndex(elem[0]);
+
+        if (idx == 0) {
+            m_boost = stringToBool(elem[1]);
+        }
+        else if (idx < CONFFIELDS && isNumber(elem[1])) {
+            setValue(idx, stringToDouble(elem[1]));
+        }
+        else if (idx < CONFFIELDS) {
+            ok = expr->add(idx, elem[1]) && ok;
+        }
 
         s.clear();
         elem.clear();
@@ -115,9 +146,98 @@ bool Conf::readConfigFile() {
 
     fin.close();
 
+    if (!ok || !expr->compile()) {
+        return false;
+    }
+
+    m_expr.reset();
+
+    if (!expr->empty()) {
+        m_expr = expr;
+    }
+
+    m_fixed = 0;
+    evaluate();
+
     return true;
 }
 
+const char *Conf::key(size_t idx) {
+    return
+        (idx < CONFFIELDS) ? confKeys[idx] : "";
+}
+
+size_t Conf::keyIndex(const string &key) {
+
+    for (size_t i=0; i<CONFFIELDS; i++) {
+        if (key == confKeys[i]) {
+            return i;
+        }
+    }
+
+    return CONFFIELDS;
+}
+
+double Conf::value(size_t idx) const {
+
+    if (idx == 0) {
+        return m_boost ? 1.0 : 0.0;
+    }
+
+    return
+        (idx < CONFFIELDS) ? this->*field(idx) : 0.0;
+}
+
+void Conf::setValue(size_t idx, double val) {
+
+    if (idx == 0) {
+        m_boost = (val != 0.0);
+    }
+    else if (idx < CONFFIELDS) {
+        this->*field(idx) = val;
+    }
+
+    if (idx < CONFFIELDS) {
+        m_fixed |= uint64_t(1) << idx;
+    }
+}
+
+void Conf::values(double *vals) const {
+
+    for (size_t i=0; i<CONFFIELDS; i++) {
+        vals[i] = value(i);
+    }
+}
+
+void Conf::evaluate() {
+
+    if (!m_expr) {
+        return;
+    }
+
+    // the expressions set their own fields, which are not given
+    const uint64_t fixed = m_fixed;
+
+    m_expr->evaluate(*this, fixed);
+
+    m_fixed = fixed;
+}
+
+double Conf::*Conf::field(size_t idx) {
+
+    static double Conf::* const fields[CONFFIELDS] = {
+        nullptr, &Conf::m_n, &Conf::m_i, &Conf::m_vh, &Conf::m_eps, &Conf::m_r, &Conf::m_l,
+        &Conf::m_p0, &Conf::m_t0, &Conf::m_muv,
+        &Conf::m_pk, &Conf::m_iceff, &Conf::m_nk, &Conf::m_alpha, &Conf::m_etav, &Conf::m_pr, &Conf::m_tr, &Conf::m_dt,
+        &Conf::m_C, &Conf::m_H, &Conf::m_O, &Conf::m_hu,
+        &Conf::m_teta,
+        &Conf::m_n1, &Conf::m_n2s,
+        &Conf::m_phiz, &Conf::m_ksi, &Conf::m_m, &Conf::m_da
+    };
+
+    return fields[idx];
+}
+
 bool Conf::createBlank() const {
 
     ofstream fout(CONFIGFILE);
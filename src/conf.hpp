@@ -21,12 +21,32 @@
 #ifndef CONF_HPP
 #define CONF_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <memory>
+
+class ConfExpr;
+
 class Conf {
 
 public:
 
     bool readConfigFile();
 
+    // Access to the fields by index. The order is the order of the keys
+    // in the configuration file, boost is stored as 0 or 1.
+    static const char *key(size_t);
+    static size_t keyIndex(const std::string &); // CONFFIELDS if unknown
+    double value(size_t) const;
+    void setValue(size_t, double);
+    void values(double *) const;
+
+    // Values of the expression-valued fields (see ConfExpr) from the
+    // others. The fields given by setValue() keep their values, so a
+    // sweep or a solver may override an expression.
+    void evaluate();
+
     bool   val_boost() const { return m_boost; }
     double val_n()     const { return m_n;     }
     double val_i()     const { return m_i;     }
@@ -66,6 +86,11 @@ public:
 private:
 
     bool createBlank() const;
+    static double Conf::*field(size_t);
+
+    // shared by the copies, which are made per case
+    std::shared_ptr<const ConfExpr> m_expr;
+    uint64_t m_fixed = 0; // bit per field given by setValue()
 
     bool   m_boost = false;
     double m_n     = 0;
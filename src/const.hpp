@@ -30,6 +30,54 @@
 #define ERRORMSGBLANK  "vibe72 ERROR =>\t"
 #define WARNMSGBLANK   "vibe72 WARNING =>\t"
 
+#define SWEEPFILE      "vibe72_sweep.txt"
+#define STOREFILE      "vibe72_store.bin"
+#define OPTIMFILE      "vibe72_optim.txt"
+#define MAPFILE        "vibe72_map.bin"
+#define DAQFILE        "vibe72_daq.txt"
+#define DOEFILE        "vibe72_doe.txt"
+#define REFINEFILE     "vibe72_refine.txt"
+#define METRICSFILE    "vibe72_metrics.prom"
+#define WATCHFILE      "vibe72_results.csv"
+
+#define CONFFIELDS  29
+#define CALCOUTPUTS 7
+
+#define PARALLELDAMAX 0.01
+#define SCHEDCHUNKS   64
+#define SCHEDBLOCKS   4096
+#define SCHEDSAMPLES  8
+#define JOURNALBATCH  64
+#define CHECKPOINTSEC 30
+#define STOREBLOCK    1024
+#define SOLVEMAXEVALS 100
+#define SOLVESTEP     0.05
+#define SOLVETOL      1e-9
+#define OPTIMCROSS    0.9
+#define OPTIMETAC     15.0
+#define OPTIMETAM     20.0
+#define MAPMAXAXES    12
+#define MAPCHECKS     1000
+#define METRICSSEC     5
+#define METRICSBUCKETS 160
+#define WATCHSETTLEMS  10
+#define WATCHPOLLMS    50
+#define CLOSEDMAXEVALS 40
+#define CLOSEDTOL      1e-9
+#define CLOSEDMAXSLOPE 10.0
+#define ANALYZECHUNK   256
+#define ANALYZELANES   8
+#define EXPRSTACK      32
+#define REFINEMAXAXES  4
+#define PARAREALSLICES 64
+#define PARAREALDA     0.1
+#define PARAREALTOL    1e-12
+#define WCETCALLS      100000
+#define WCETWARMUP     1000
+#define WCETSPREAD     0.1
+#define WCETDEADLINE   1000.0
+#define DOEMAXDIMS     32
+
 #define PI 3.14159265
 #define E 2.71828182
 
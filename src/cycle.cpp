@@ -0,0 +1,444 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: cycle.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cycle.hpp"
+#include "const.hpp"
+#include "conf.hpp"
+#include "auxf.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+void cycleInlet(const Conf &conf, InletState &in) {
+
+    const bool   c_boost = conf.val_boost();
+    const double c_eps   = conf.val_eps();
+
+    const double c_p0    = conf.val_p0();
+    const double c_t0    = conf.val_t0();
+    const double c_muv   = conf.val_muv();
+
+    const double c_pk    = conf.val_pk();
+    const double c_iceff = conf.val_iceff();
+    const double c_nk    = conf.val_nk();
+    const double c_etav  = conf.val_etav();
+    const double c_pr    = conf.val_pr();
+    const double c_tr    = conf.val_tr();
+    const double c_dt    = conf.val_dt();
+
+    const double c_C     = conf.val_C();
+    const double c_H     = conf.val_H();
+    const double c_O     = conf.val_O();
+
+    in.tk = 0;
+    in.tks = 0;
+
+    if (c_boost) {
+        in.tk = pow(c_pk / c_p0, (c_nk - 1.0) / c_nk) * (c_t0 + 273.0);
+        in.tks = in.tk - c_iceff * (in.tk - (c_t0 + 273.0));
+        in.pa = ((c_eps - 1.0) * c_etav * kpa_to_kgfcm2(c_pk) * (in.tks + c_dt) / in.tks + kpa_to_kgfcm2(c_pr)) / c_eps;
+        in.gamma = (1.0 / (c_eps - 1.0) / c_etav) * (c_pr / c_pk) * (in.tks / c_tr);
+        in.ta = (in.tks + c_dt + in.gamma * c_tr) / (1.0 + in.gamma);
+    }
+    else {
+        in.pa = ((c_eps - 1.0) * c_etav * kpa_to_kgfcm2(c_p0) * (c_t0 + c_dt) / c_t0 + kpa_to_kgfcm2(c_pr)) / c_eps;
+        in.gamma = (1.0 / (c_eps - 1.0) / c_etav) * (c_pr / c_p0) * (c_t0 / c_tr);
+        in.ta = (c_t0 + c_dt + in.gamma * c_tr) / (1.0 + in.gamma);
+    }
+
+    in.l0s = (8.0 / 3.0 * c_C + 8.0 * c_H - c_O) / 0.232;
+    in.l0 = (c_C / 12.0 + c_H / 4.0 - c_O / 32.0) / 0.21;
+    in.va = (848.0 / 10000.0 / c_muv) * (in.ta / in.pa);
+}
+
+bool cycleValidAngles(double teta, double phiz, double da) {
+
+    // the bounds of the loops of cycleSizes() first
+    if (!(da > 0 && phiz > 0 && teta > -180.0 && teta < 180.0 &&
+          (360.0 + phiz) / da < 1e9)) {
+        return false;
+    }
+
+    size_t comp = 0;
+    size_t fire = 0;
+    size_t exp = 0;
+
+    cycleSizes(teta, phiz, da, comp, fire, exp);
+
+    return
+        comp >= 1 && fire >= 1 && exp >= 1;
+}
+
+void cycleSizes(double teta, double phiz, double da,
+                size_t &comp, size_t &fire, size_t &exp) {
+
+    double phi = -180;
+
+    comp = 0;
+
+    while (phi <= -teta) {
+        comp++;
+        phi += da;
+    }
+
+    phi -= da;
+    fire = phiz / da + 1;
+
+    double phi_last = phi;
+
+    for (size_t i=0; i<fire; i++) {
+        phi_last = phi;
+        phi += da;
+    }
+
+    phi = phi_last + da;
+    exp = 0;
+
+    while (phi <= 180.0) {
+        exp++;
+        phi += da;
+    }
+}
+
+double cycleQz(const Conf &conf, const InletState &in) {
+    return
+        conf.val_ksi() * conf.val_hu() / (1.0 + in.gamma) / conf.val_alpha() / in.l0s;
+}
+
+double cycleBetamax(const Conf &conf, const InletState &in) {
+
+    const double beta0max = 1.0 + (conf.val_H() / 4.0 + conf.val_O() / 32.0) / conf.val_alpha() / in.l0;
+
+    return
+        (beta0max + in.gamma) / (1.0 + in.gamma);
+}
+
+double cycleResidualTemperature(const Conf &conf, double pb, double tb) {
+    return
+        tb / cbrt(pb / kpa_to_kgfcm2(conf.val_pr()));
+}
+
+void cycleKinematics(
+    const double *phi, size_t n,
+    double lam, double eps, double va,
+    double *sigma, double *psialpha, double *v
+    ) {
+
+    for (size_t i=0; i<n; i++) {
+        cycleKinematicsPoint(phi[i], lam, eps, va, sigma[i], psialpha[i], v[i]);
+    }
+}
+
+void cyclePolytrope(
+    const double *v, size_t n,
+    double p0, double t0, double v0, double k,
+    double *p, double *t
+    ) {
+
+    for (size_t i=0; i<n; i++) {
+        cyclePolytropePoint(v[i], p0, t0, v0, k, p[i], t[i]);
+    }
+}
+
+void cycleBurn(
+    const double *phi, size_t n,
+    double teta, double phiz, double m, double betamax,
+    double *x, double *w0, double *beta
+    ) {
+
+    for (size_t i=0; i<n; i++) {
+        cycleBurnPoint(phi[i], teta, phiz, m, betamax, x[i], w0[i], beta[i]);
+    }
+}
+
+void cycleFire(
+    size_t from, size_t to, const FireParams &fp,
+    const double *x, const double *psialpha, const double *beta,
+    double *k, double *ks, double *p, double *t
+    ) {
+
+    for (size_t i=from; i<to; i++) {
+
+        if (i == 0) {
+            cycleFireFirst(fp, x[i], k[i], ks[i], p[i], t[i]);
+            continue;
+        }
+
+        cycleFireStep(
+            fp,
+            x[i-1], x[i], psialpha[i-1], psialpha[i],
+            beta[i-1], beta[i], k[i-1], p[i-1], t[i-1],
+            k[i], ks[i], p[i], t[i]
+            );
+    }
+}
+
+void cycleFireCoarse(
+    size_t from, size_t to, size_t stride, const FireParams &fp,
+    const double *x, const double *psialpha, const double *beta,
+    double &k, double &p, double &t
+    ) {
+
+    double ks = 0;
+
+    for (size_t i=from; i<to; ) {
+
+        const size_t j = std::min(i + stride, to);
+
+        cycleFireStep(
+            fp,
+            x[i], x[j], psialpha[i], psialpha[j],
+            beta[i], beta[j], k, p, t,
+            k, ks, p, t
+            );
+
+        i = j;
+    }
+}
+
+void cyclePerformance(
+    const Conf &conf, const InletState &in, double qz,
+    double py, double psialpha_y, double pz, double psialpha_z,
+    double pb, double lyz_sum, Performance &perf
+    ) {
+
+    const double c_n   = conf.val_n();
+    const double c_i   = conf.val_i();
+    const double c_vh  = conf.val_vh();
+    const double c_eps = conf.val_eps();
+    const double c_r   = conf.val_r();
+    const double c_hu  = conf.val_hu();
+    const double c_n1  = conf.val_n1();
+    const double c_n2s = conf.val_n2s();
+    const double c_ksi = conf.val_ksi();
+
+    // indicated parameters
+
+    const double lay = 10000.0 * in.va / (c_eps * (c_n1 - 1.0)) * (in.pa * c_eps - py * psialpha_y);
+    const double lzb = 10000.0 * in.va / (c_eps * (c_n2s - 1.0)) * (pz * psialpha_z - pb * c_eps);
+    const double lyz = 10000.0 * in.va / c_eps * lyz_sum;
+
+    perf.li = lay + lzb + lyz;
+    perf.pi = c_eps / 10000.0 / (c_eps - 1.0) * perf.li / in.va;
+    perf.etai = c_ksi * perf.li / 427 / qz;
+    perf.gi = 1000.0 * 632 / c_hu / perf.etai;
+
+    // effective parameters
+
+    const double cm = c_r * 0.001 * 2.0 * c_n / 30.0;
+
+    double a = 0;
+    double b = 0;
+
+    if (c_i <= 6) {
+        a = 0.9;
+        b = 0.12;
+    }
+    else if (c_i <= 8 ) {
+        a = 0.7;
+        b = 0.12;
+    }
+    else {
+        a = 0.3;
+        b = 0.12;
+    }
+
+    perf.pm = a + b * cm;
+    perf.pe = perf.pi - perf.pm;
+    perf.etam = perf.pe / perf.pi;
+    perf.etae = perf.etai * perf.etam;
+    perf.ge = 1000.0 * 632 / c_hu / perf.etae;
+
+    perf.Ne = perf.pe * c_vh * c_n / 225.0 / 4.0;
+}
+
+void cycleOutputs(const Performance &perf, double p_comp_max, double p_fire_max,
+                  double *out) {
+
+    out[0] = kgfcm2_to_kpa(perf.pe);
+    out[1] = perf.etae;
+    out[2] = perf.gi * 1.36;
+    out[3] = perf.ge * 1.36;
+    out[4] = perf.Ne / 1.36;
+    out[5] = kgfcm2_to_kpa(p_comp_max);
+    out[6] = kgfcm2_to_kpa(p_fire_max);
+}
+
+void cycleStream(const Conf &conf, double *trace_phi, double *trace_p,
+                 double *trace_t, double *out) {
+
+    size_t comp = 0;
+    size_t fire = 0;
+    size_t exp = 0;
+
+    cycleSizes(conf.val_teta(), conf.val_phiz(), conf.val_da(), comp, fire, exp);
+    cycleStreamSized(conf, comp, fire, exp, trace_phi, trace_p, trace_t, out);
+}
+
+void cycleStreamSized(const Conf &conf, size_t comp, size_t fire, size_t exp,
+                      double *trace_phi, double *trace_p, double *trace_t,
+                      double *out) {
+
+    const double c_eps   = conf.val_eps();
+    const double c_alpha = conf.val_alpha();
+    const double c_teta  = conf.val_teta();
+    const double c_n1    = conf.val_n1();
+    const double c_n2s   = conf.val_n2s();
+    const double c_phiz  = conf.val_phiz();
+    const double c_m     = conf.val_m();
+    const double c_da    = conf.val_da();
+
+    const double lam = conf.val_r() / conf.val_l();
+
+    InletState in;
+    cycleInlet(conf, in);
+
+    size_t j = 0;
+
+    // compression phase; a point is written when the next one is known,
+    // so the last one is left to the fire phase
+
+    double phi = -180;
+
+    double psialpha_y = 0;
+    double py = 0;
+    double ty = 0;
+    double phi_y = 0;
+    bool pending = false;
+
+    for (size_t i=0; i<comp; i++) {
+
+        if (pending) {
+            if (trace_phi) { trace_phi[j] = phi_y;                }
+            if (trace_p)   { trace_p[j]   = kgfcm2_to_kpa(py);    }
+            if (trace_t)   { trace_t[j]   = ty - 273.0;           }
+            j++;
+        }
+
+        double sigma = 0;
+        double v = 0;
+
+        cycleKinematicsPoint(phi, lam, c_eps, in.va, sigma, psialpha_y, v);
+        cyclePolytropePoint(v, in.pa, in.ta, in.va, c_n1, py, ty);
+
+        phi_y = phi;
+        pending = true;
+
+        phi += c_da;
+    }
+
+    // fire phase
+
+    phi -= c_da;
+
+    FireParams fp;
+
+    fp.eps   = c_eps;
+    fp.va    = in.va;
+    fp.alpha = c_alpha;
+    fp.qz    = cycleQz(conf, in);
+    fp.py    = py;
+    fp.ty    = ty;
+    fp.k_ty  = ty / py / psialpha_y;
+
+    const double betamax = cycleBetamax(conf, in);
+
+    double x0 = 0, psialpha0 = 0, beta0 = 0, k0 = 0, p0 = 0, t0 = 0, v0 = 0;
+    double phi_last = phi;
+    double p_fire_max = 0;
+    double lyz_sum = 0;
+
+    for (size_t i=0; i<fire; i++) {
+
+        double x = 0, w0 = 0, beta = 0;
+        double sigma = 0, psialpha = 0, v = 0;
+        double k = 0, ks = 0, p = 0, t = 0;
+
+        cycleBurnPoint(phi, c_teta, c_phiz, c_m, betamax, x, w0, beta);
+        cycleKinematicsPoint(phi, lam, c_eps, in.va, sigma, psialpha, v);
+
+        if (i == 0) {
+            cycleFireFirst(fp, x, k, ks, p, t);
+            p_fire_max = p;
+        }
+        else {
+            cycleFireStep(fp, x0, x, psialpha0, psialpha, beta0, beta, k0, p0, t0,
+                          k, ks, p, t);
+            lyz_sum += ((p0 + p) / 2.0) * (psialpha - psialpha0);
+        }
+
+        if (p > p_fire_max) {
+            p_fire_max = p;
+        }
+
+        if (trace_phi) { trace_phi[j] = phi;              }
+        if (trace_p)   { trace_p[j]   = kgfcm2_to_kpa(p); }
+        if (trace_t)   { trace_t[j]   = t - 273.0;        }
+        j++;
+
+        x0 = x;
+        psialpha0 = psialpha;
+        beta0 = beta;
+        k0 = k;
+        p0 = p;
+        t0 = t;
+        v0 = v;
+
+        phi_last = phi;
+        phi += c_da;
+    }
+
+    // expansion phase
+
+    const double pz = p0;
+    const double tz = t0;
+    const double vz = v0;
+    const double psialpha_z = psialpha0;
+
+    double pb = 0;
+
+    phi = phi_last + c_da;
+
+    for (size_t i=0; i<exp; i++) {
+
+        double sigma = 0, psialpha = 0, v = 0;
+        double p = 0, t = 0;
+
+        cycleKinematicsPoint(phi, lam, c_eps, in.va, sigma, psialpha, v);
+        cyclePolytropePoint(v, pz, tz, vz, c_n2s, p, t);
+
+        if (trace_phi) { trace_phi[j] = phi;              }
+        if (trace_p)   { trace_p[j]   = kgfcm2_to_kpa(p); }
+        if (trace_t)   { trace_t[j]   = t - 273.0;        }
+        j++;
+
+        pb = p;
+        phi += c_da;
+    }
+
+    if (out) {
+
+        Performance perf;
+
+        cyclePerformance(conf, in, fp.qz, py, psialpha_y, pz, psialpha_z,
+                         pb, lyz_sum, perf);
+        cycleOutputs(perf, py, p_fire_max, out);
+    }
+}
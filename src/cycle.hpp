@@ -0,0 +1,257 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: cycle.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CYCLE_HPP
+#define CYCLE_HPP
+
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#include "const.hpp"
+#include "conf.hpp"
+
+// Relations of the cycle. Calc keeps the whole traces and calls the
+// range functions, cycleStream() walks the cycle point by point; both
+// use the same per-point functions, so their results are identical.
+//
+// All range functions work on [0, n) of the given arrays and do not
+// depend on each other between indexes, so any range may be split and
+// computed concurrently.
+
+// state after the inlet phase
+struct InletState {
+    double tk    = 0;
+    double tks   = 0;
+    double pa    = 0;
+    double gamma = 0;
+    double ta    = 0;
+    double l0s   = 0;
+    double l0    = 0;
+    double va    = 0;
+};
+
+void cycleInlet(const Conf &, InletState &);
+
+// whether the angles give a cycle of a sane number of points with at
+// least one point of every phase by cycleSizes()
+bool cycleValidAngles(double teta, double phiz, double da);
+
+// number of points of the phases, the angles accumulated as Calc does
+void cycleSizes(double teta, double phiz, double da,
+                size_t &comp, size_t &fire, size_t &exp);
+
+inline double cycleSigma(double phi, double lam) {
+
+    const double phi_rad = phi * PI / 180.0;
+
+    return
+        (1.0 + 1.0 / lam) - (cos(phi_rad) + 1.0 / lam * pow(1.0 - pow(lam, 2.0) * pow(sin(phi_rad), 2.0), 0.5));
+}
+
+inline void cycleKinematicsPoint(
+    double phi, double lam, double eps, double va,
+    double &sigma, double &psialpha, double &v
+    ) {
+
+    sigma = cycleSigma(phi, lam);
+    psialpha = 1.0 + (eps - 1.0) / 2.0 * sigma;
+    v = va / eps * psialpha;
+}
+
+inline void cyclePolytropePoint(
+    double v, double p0, double t0, double v0, double k,
+    double &p, double &t
+    ) {
+
+    p = p0 * pow(v0 / v, k);
+    t = t0 * pow(v0 / v, k - 1.0);
+}
+
+inline void cycleBurnPoint(
+    double phi, double teta, double phiz, double m, double betamax,
+    double &x, double &w0, double &beta
+    ) {
+
+    // the accumulated first angle of the fire phase may lie a rounding
+    // error or a step before teta, where the law is not defined
+    const double phi_rel = std::max(phi + teta, 0.0);
+
+    x = 1.0 - pow(E, -6.908 * pow(phi_rel / phiz, m + 1.0));
+    w0 = 6.908 * (m + 1.0) * pow(phi_rel / phiz, m) * pow(E, -6.908 * pow(phi_rel / phiz, m + 1.0));
+    beta = 1.0 + (betamax - 1.0) * x;
+}
+
+// heat of the fuel per unit of the charge and the maximum coefficient of
+// the molecular change
+double cycleQz(const Conf &, const InletState &);
+double cycleBetamax(const Conf &, const InletState &);
+
+// temperature of the residual gases which closes the cycle, from the
+// state at the end of the expansion and the exhaust pressure pr:
+// tr = tb / (pb / pr)^(1/3)
+double cycleResidualTemperature(const Conf &, double pb, double tb);
+
+// sigma, psialpha and v for the given angles
+void cycleKinematics(
+    const double *phi, size_t n,
+    double lam, double eps, double va,
+    double *sigma, double *psialpha, double *v
+    );
+
+// p and t of the polytropic process started from (p0, t0, v0)
+void cyclePolytrope(
+    const double *v, size_t n,
+    double p0, double t0, double v0, double k,
+    double *p, double *t
+    );
+
+// x, w0 and beta of the Vibe combustion law
+void cycleBurn(
+    const double *phi, size_t n,
+    double teta, double phiz, double m, double betamax,
+    double *x, double *w0, double *beta
+    );
+
+// constants of the fire phase recurrence
+struct FireParams {
+    double eps   = 0;
+    double va    = 0;
+    double alpha = 0;
+    double qz    = 0;
+    double k_ty  = 0;
+    double py    = 0;
+    double ty    = 0;
+};
+
+inline void cycleFireFirst(
+    const FireParams &fp, double x,
+    double &k, double &ks, double &p, double &t
+    ) {
+
+    k = 1.259 + 76.7 / fp.ty - (0.005 + 0.0372 / fp.alpha) * x;
+    ks = (k + 1.0) / (k - 1.0);
+    p = fp.py;
+    t = fp.ty;
+}
+
+// step of the recurrence from the point 0 to the point 1
+inline void cycleFireStep(
+    const FireParams &fp,
+    double x0, double x1, double psialpha0, double psialpha1,
+    double beta0, double beta1, double k0, double p0, double t0,
+    double &k1, double &ks1, double &p1, double &t1
+    ) {
+
+    k1 = 1.259 + 76.7 / t0 - (0.005 + 0.0372 / fp.alpha) * ((x0 + x1) / 2.0);
+
+    const double ksm = (k0 + k1) / 2.0;
+    ks1 = (ksm + 1.0) / (ksm - 1.0);
+
+    p1 = (0.0854 * fp.eps / fp.va * fp.qz * (x1 - x0) + p0 * (ks1 * psialpha0 - psialpha1)) / (ks1 * psialpha1 - psialpha0);
+    t1 = fp.k_ty * p1 * psialpha1 / ((beta0 + beta1) / 2.0);
+}
+
+// Inverse step: the burnt fraction x1 which gives the pressure p1 at the
+// point 1. k1 depends on x1 weakly, so the predictor from x0 is corrected
+// once; t1 follows from x1 as in the forward step.
+inline void cycleBurnFromPressure(
+    const FireParams &fp, double betamax,
+    double x0, double psialpha0, double psialpha1,
+    double beta0, double k0, double p0, double t0, double p1,
+    double &x1, double &k1, double &t1
+    ) {
+
+    const double c = 0.0854 * fp.eps / fp.va * fp.qz;
+
+    x1 = x0;
+
+    for (int i=0; i<2; i++) {
+
+        k1 = 1.259 + 76.7 / t0 - (0.005 + 0.0372 / fp.alpha) * ((x0 + x1) / 2.0);
+
+        const double ksm = (k0 + k1) / 2.0;
+        const double ks1 = (ksm + 1.0) / (ksm - 1.0);
+
+        x1 = x0 + (p1 * (ks1 * psialpha1 - psialpha0) - p0 * (ks1 * psialpha0 - psialpha1)) / c;
+    }
+
+    const double beta1 = 1.0 + (betamax - 1.0) * x1;
+
+    t1 = fp.k_ty * p1 * psialpha1 / ((beta0 + beta1) / 2.0);
+}
+
+// fire phase recurrence on [from, to); every index depends on the
+// previous one, so the ranges must be computed in order
+void cycleFire(
+    size_t from, size_t to, const FireParams &fp,
+    const double *x, const double *psialpha, const double *beta,
+    double *k, double *ks, double *p, double *t
+    );
+
+// The same recurrence from the point from, where it is (k, p, t), to the
+// point to by the steps over stride points; the coarse propagator of the
+// parareal mode. (k, p, t) get the state at the point to.
+void cycleFireCoarse(
+    size_t from, size_t to, size_t stride, const FireParams &fp,
+    const double *x, const double *psialpha, const double *beta,
+    double &k, double &p, double &t
+    );
+
+// indicated and effective parameters
+struct Performance {
+    double li   = 0;
+    double pi   = 0;
+    double etai = 0;
+    double gi   = 0;
+    double pm   = 0;
+    double pe   = 0;
+    double etam = 0;
+    double etae = 0;
+    double ge   = 0;
+    double Ne   = 0;
+};
+
+// lyz_sum is the sum of the mean fire pressures by the psialpha steps
+void cyclePerformance(
+    const Conf &, const InletState &, double qz,
+    double py, double psialpha_y, double pz, double psialpha_z,
+    double pb, double lyz_sum, Performance &
+    );
+
+// scalar results in the report units, see outputName()
+void cycleOutputs(const Performance &, double p_comp_max, double p_fire_max,
+                  double *out);
+
+// Whole cycle point by point, without intermediate arrays. The traces
+// (compression without its last point, which starts the fire phase,
+// then fire and expansion; kPa and degC) are written to the arrays that
+// are not null; each must hold comp - 1 + fire + exp points of
+// cycleSizes(). out, if not null, gets CALCOUTPUTS scalar results.
+void cycleStream(const Conf &, double *phi, double *p, double *t, double *out);
+
+// The same with the sizes of cycleSizes() for the angles of the
+// configuration, found beforehand: every loop has a fixed length and
+// nothing is allocated, thrown or written out, so the time of a call is
+// bounded (the real-time mode).
+void cycleStreamSized(const Conf &, size_t comp, size_t fire, size_t exp,
+                      double *phi, double *p, double *t, double *out);
+
+#endif // CYCLE_HPP
@@ -0,0 +1,307 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: doe.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "doe.hpp"
+#include "const.hpp"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using std::string;
+using std::vector;
+using std::mt19937_64;
+
+namespace {
+
+// primitive polynomials x^s + ... + 1 (a gives the inner coefficients)
+// and the initial direction numbers of the Sobol dimensions after the
+// first one, by S. Joe and F. Y. Kuo (new-joe-kuo-6.21201)
+struct SobolInit {
+    uint32_t s;
+    uint32_t a;
+    uint32_t m[7];
+};
+
+const SobolInit SOBOLINIT[DOEMAXDIMS-1] = {
+    {1,  0, {1}},
+    {2,  1, {1, 3}},
+    {3,  1, {1, 3, 1}},
+    {3,  2, {1, 1, 1}},
+    {4,  1, {1, 1, 3, 3}},
+    {4,  4, {1, 3, 5, 13}},
+    {5,  2, {1, 1, 5, 5, 17}},
+    {5,  4, {1, 1, 5, 5, 5}},
+    {5,  7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6,  1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7,  1, {1, 3, 7, 11, 23, 15, 103}},
+    {7,  4, {1, 3, 7, 13, 13, 15, 69}},
+    {7,  7, {1, 1, 3, 13, 7, 35, 63}},
+    {7,  8, {1, 3, 5, 9, 1, 25, 53}},
+    {7, 14, {1, 3, 1, 13, 9, 35, 107}},
+    {7, 19, {1, 3, 1, 5, 27, 61, 31}},
+    {7, 21, {1, 1, 5, 11, 19, 41, 61}},
+    {7, 28, {1, 3, 5, 3, 3, 13, 69}},
+    {7, 31, {1, 1, 7, 13, 1, 19, 1}},
+    {7, 32, {1, 3, 7, 5, 13, 19, 59}},
+    {7, 37, {1, 1, 3, 9, 25, 29, 41}},
+    {7, 41, {1, 3, 5, 13, 23, 1, 55}},
+    {7, 42, {1, 3, 7, 3, 13, 59, 17}}
+};
+
+// the bases of the Halton dimensions
+const uint32_t PRIMES[DOEMAXDIMS] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+    59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131
+};
+
+const double TWOTO32 = 4294967296.0;
+
+uint64_t splitMix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint32_t reverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Owen scrambling of the bits from the highest one: the hash of
+// S. Laine and T. Karras over the reversed bits (B. Burley, 2020)
+uint32_t nestedScramble(uint32_t x, uint32_t seed) {
+
+    x = reverseBits(x);
+
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+
+    return reverseBits(x);
+}
+
+// pseudorandom permutation of [0, n) by index, by cycle walking over the
+// hash of A. Kensler (Correlated Multi-Jittered Sampling, 2013)
+uint32_t permute(uint32_t i, uint32_t n, uint32_t p) {
+
+    uint32_t w = n - 1;
+
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+
+    do {
+        i ^= p;
+        i *= 0xe170893du;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3fu;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69u;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303u;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3u;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3dfu;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= n);
+
+    return (i + p) % n;
+}
+
+// pseudorandom number in [0, 1) by index, of the same paper
+double randomUnit(uint32_t i, uint32_t p) {
+
+    i ^= p;
+    i ^= i >> 17;
+    i ^= i >> 10;
+    i *= 0xb36534e5u;
+    i ^= i >> 12;
+    i ^= i >> 21;
+    i *= 0x93fc4795u;
+    i ^= 0xdf6e307fu;
+    i ^= i >> 17;
+    i *= 1 | p >> 18;
+
+    return i / TWOTO32;
+}
+
+}
+
+bool Doe::designByName(const string &name, Design &design) {
+
+    if (name == "sobol") {
+        design = SOBOL;
+    }
+    else if (name == "halton") {
+        design = HALTON;
+    }
+    else if (name == "lhs") {
+        design = LHS;
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+bool Doe::init(Design design, size_t dims, uint64_t points,
+               uint64_t seed, bool scramble) {
+
+    if (dims == 0 || dims > DOEMAXDIMS || points == 0 ||
+        (design != HALTON && points > 0xffffffffULL)) {
+        return false;
+    }
+
+    m_design = design;
+    m_dims = dims;
+    m_points = points;
+    m_scramble = scramble;
+
+    m_seeds.resize(dims);
+
+    for (size_t d=0; d<dims; d++) {
+        m_seeds[d] = uint32_t(splitMix(seed * DOEMAXDIMS + d));
+    }
+
+    m_directions.clear();
+    m_perms.clear();
+
+    if (design == SOBOL) {
+
+        m_directions.resize(dims * 32);
+
+        for (size_t b=0; b<32; b++) {
+            m_directions[b] = uint32_t(1) << (31 - b);
+        }
+
+        for (size_t d=1; d<dims; d++) {
+
+            const SobolInit &si = SOBOLINIT[d-1];
+            uint32_t *v = &m_directions[d * 32];
+
+            for (size_t b=0; b<32; b++) {
+
+                if (b < si.s) {
+                    v[b] = si.m[b] << (31 - b);
+                    continue;
+                }
+
+                v[b] = v[b - si.s] ^ (v[b - si.s] >> si.s);
+
+                for (size_t k=1; k<si.s; k++) {
+                    if ((si.a >> (si.s - 1 - k)) & 1) {
+                        v[b] ^= v[b - k];
+                    }
+                }
+            }
+        }
+    }
+    else if (design == HALTON) {
+
+        m_perms.resize(dims);
+
+        for (size_t d=0; d<dims; d++) {
+
+            vector<uint32_t> &perm = m_perms[d];
+            perm.resize(PRIMES[d]);
+
+            for (uint32_t i=0; i<PRIMES[d]; i++) {
+                perm[i] = i;
+            }
+
+            // the zero digit stays, so do the infinite trailing zeros
+            if (scramble) {
+                mt19937_64 rng(m_seeds[d]);
+                std::shuffle(perm.begin() + 1, perm.end(), rng);
+            }
+        }
+    }
+
+    return true;
+}
+
+double Doe::sample(uint64_t index, size_t dim) const {
+
+    if (m_design == SOBOL) {
+
+        const uint32_t *v = &m_directions[dim * 32];
+        uint32_t x = 0;
+
+        for (uint32_t i = uint32_t(index), b = 0; i != 0; i >>= 1, b++) {
+            if (i & 1) {
+                x ^= v[b];
+            }
+        }
+
+        if (m_scramble) {
+            x = nestedScramble(x, m_seeds[dim]);
+        }
+
+        return x / TWOTO32;
+    }
+
+    if (m_design == HALTON) {
+
+        const uint32_t base = PRIMES[dim];
+        const vector<uint32_t> &perm = m_perms[dim];
+
+        double x = 0;
+        double scale = 1.0 / base;
+
+        for (uint64_t i = index; i != 0; i /= base) {
+            x += perm[i % base] * scale;
+            scale /= base;
+        }
+
+        return x;
+    }
+
+    // the stratum of the point along the dimension and its place in it
+
+    const uint32_t stratum = permute(uint32_t(index), uint32_t(m_points), m_seeds[dim]);
+    const double jitter = m_scramble ? randomUnit(uint32_t(index), m_seeds[dim] ^ 0x5bd1e995u) : 0.5;
+
+    return (stratum + jitter) / m_points;
+}
@@ -0,0 +1,69 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: doe.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DOE_HPP
+#define DOE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Designs of experiments in the unit cube: the Sobol and Halton low
+// discrepancy sequences and the Latin hypercube. Every point is made from
+// its index alone, so the points are generated lazily where they are
+// calculated and any part of the design (a worker, a shard) is the same
+// as in the whole one.
+//
+// The scrambling is the nested uniform (Owen) one of the Sobol points,
+// the random digit permutations of the Halton ones and the jitter inside
+// the strata of the Latin hypercube; all of them are given by the seed.
+class Doe {
+
+public:
+
+    enum Design { SOBOL, HALTON, LHS };
+
+    // SOBOL for "sobol" and so on; false if the name is unknown
+    static bool designByName(const std::string &, Design &);
+
+    // false if there are too many dimensions or points for the design
+    bool init(Design, size_t dims, uint64_t points, uint64_t seed, bool scramble);
+
+    size_t   dims()   const { return m_dims;   }
+    uint64_t points() const { return m_points; }
+
+    // the coordinate of the point in [0, 1)
+    double sample(uint64_t index, size_t dim) const;
+
+private:
+
+    Design   m_design   = SOBOL;
+    size_t   m_dims     = 0;
+    uint64_t m_points   = 0;
+    bool     m_scramble = true;
+
+    std::vector<uint32_t> m_seeds;      // of every dimension
+    std::vector<uint32_t> m_directions; // Sobol, 32 of every dimension
+    std::vector<std::vector<uint32_t>> m_perms; // Halton, of the digits
+
+};
+
+#endif // DOE_HPP
@@ -0,0 +1,181 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: enginemap.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "enginemap.hpp"
+#include "const.hpp"
+#include "mapfile.hpp"
+
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <cstring>
+
+using std::cout;
+using std::string;
+
+const char engineMapMagic[8] = { 'V', 'I', 'B', 'E', '7', '2', 'M', '1' };
+
+namespace {
+
+// whether the file of the size holds the header, the axes and exactly the
+// nodes of their grid; nothing of the file is trusted before it is checked
+bool validLayout(const char *data, size_t size) {
+
+    const EngineMapHeader *header = reinterpret_cast<const EngineMapHeader *>(data);
+
+    if (size < sizeof(EngineMapHeader) ||
+        memcmp(header->magic, engineMapMagic, sizeof(engineMapMagic)) != 0 ||
+        header->outputs != CALCOUTPUTS ||
+        header->axes == 0 || header->axes > MAPMAXAXES ||
+        size < sizeof(EngineMapHeader) + header->axes * sizeof(EngineMapAxis)) {
+        return false;
+    }
+
+    const EngineMapAxis *axes =
+        reinterpret_cast<const EngineMapAxis *>(data + sizeof(EngineMapHeader));
+
+    uint64_t points = 1;
+
+    for (size_t a=0; a<header->axes; a++) {
+
+        const EngineMapAxis &axis = axes[a];
+
+        if (axis.key >= CONFFIELDS || axis.size == 0 ||
+            !std::isfinite(axis.from) || !std::isfinite(axis.step) || axis.step == 0 ||
+            points > UINT64_MAX / axis.size) {
+            return false;
+        }
+
+        points *= axis.size;
+    }
+
+    const size_t values = size - sizeof(EngineMapHeader) - header->axes * sizeof(EngineMapAxis);
+    const size_t node = CALCOUTPUTS * sizeof(double);
+
+    return
+        header->points == points &&
+        values % node == 0 && values / node == points;
+}
+
+}
+
+bool EngineMap::open(const string &filename) {
+
+    m_header = nullptr;
+    m_axes = nullptr;
+    m_values = nullptr;
+
+    if (!m_file.open(filename)) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << filename << "\" to read!\n";
+        return false;
+    }
+
+    const EngineMapHeader *header =
+        reinterpret_cast<const EngineMapHeader *>(m_file.data());
+
+    if (!validLayout(m_file.data(), m_file.size())) {
+        cout << ERRORMSGBLANK << "File \"" << filename
+             << "\" is not an engine map of this version!\n";
+        m_file.close();
+        return false;
+    }
+
+    m_header = header;
+    m_axes = reinterpret_cast<const EngineMapAxis *>(m_file.data() + sizeof(EngineMapHeader));
+    m_values = reinterpret_cast<const double *>(m_axes + header->axes);
+
+    return true;
+}
+
+void EngineMap::interpolate(const EngineMapAxis *axes, size_t n,
+                            const double *values, const double *x, double *out) {
+
+    // the lower node of the cell and the position within it on the axes
+    // of more than one node; the others add nothing
+
+    size_t base = 0;
+    size_t stride = 1;
+    size_t active = 0;
+
+    double t[MAPMAXAXES];
+    size_t step[MAPMAXAXES];
+
+    for (size_t a=n; a>0; a--) {
+
+        const EngineMapAxis &axis = axes[a-1];
+
+        if (axis.size > 1) {
+
+            double u = (x[a-1] - axis.from) / axis.step;
+
+            if (!(u > 0)) {
+                u = 0;
+            }
+            else if (u > axis.size - 1) {
+                u = axis.size - 1;
+            }
+
+            size_t i = floor(u);
+
+            if (i > axis.size - 2) {
+                i = axis.size - 2;
+            }
+
+            base += i * stride;
+            t[active] = u - i;
+            step[active] = stride;
+            active++;
+        }
+
+        stride *= axis.size;
+    }
+
+    for (size_t k=0; k<CALCOUTPUTS; k++) {
+        out[k] = 0;
+    }
+
+    for (size_t c=0; c<(size_t(1) << active); c++) {
+
+        double w = 1;
+        size_t node = base;
+
+        for (size_t j=0; j<active; j++) {
+            if ((c >> j) & 1) {
+                w *= t[j];
+                node += step[j];
+            }
+            else {
+                w *= 1.0 - t[j];
+            }
+        }
+
+        // a point on a node does not depend on the others
+        if (w == 0) {
+            continue;
+        }
+
+        const double *v = values + node * CALCOUTPUTS;
+
+        for (size_t k=0; k<CALCOUTPUTS; k++) {
+            out[k] += w * v[k];
+        }
+    }
+}
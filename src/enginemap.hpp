@@ -0,0 +1,86 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: enginemap.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINEMAP_HPP
+#define ENGINEMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "const.hpp"
+#include "mapfile.hpp"
+
+// File of the engine map: the header, the axes and then the outputs of
+// all nodes of the grid, the first axis varying slowest and the outputs
+// of a node stored together. The file is in the host byte order.
+struct EngineMapHeader {
+    char     magic[8];
+    char     source[16];
+    uint64_t axes;
+    uint64_t outputs;
+    uint64_t points;
+    uint64_t checks;
+    double   maxError[CALCOUTPUTS];    // on the check points
+    double   maxRelError[CALCOUTPUTS];
+};
+
+struct EngineMapAxis {
+    uint64_t key;  // index of the field of Conf
+    uint64_t size;
+    double   from;
+    double   step;
+};
+
+extern const char engineMapMagic[8];
+
+// Read-only engine map, mapped into memory. The queries are answered by
+// multilinear interpolation between the nodes of the cell of the point;
+// they do not allocate and may run in any number of threads at once.
+class EngineMap {
+
+public:
+
+    bool open(const std::string &);
+
+    const EngineMapHeader &header() const { return *m_header; }
+    size_t axes() const { return m_header->axes; }
+    const EngineMapAxis &axis(size_t i) const { return m_axes[i]; }
+
+    // x holds the values of the axes in their order, out gets the
+    // CALCOUTPUTS outputs; x is clamped to the map
+    void query(const double *x, double *out) const {
+        interpolate(m_axes, m_header->axes, m_values, x, out);
+    }
+
+    static void interpolate(const EngineMapAxis *, size_t axes,
+                            const double *values, const double *x, double *out);
+
+private:
+
+    MapFile m_file;
+
+    const EngineMapHeader *m_header = nullptr;
+    const EngineMapAxis   *m_axes   = nullptr;
+    const double          *m_values = nullptr;
+
+};
+
+#endif // ENGINEMAP_HPP
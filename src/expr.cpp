@@ -0,0 +1,532 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: expr.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "expr.hpp"
+#include "const.hpp"
+#include "conf.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+
+using std::cout;
+using std::string;
+using std::vector;
+
+// recursive descent parser emitting the postfix code
+class ExprParser {
+
+public:
+
+    ExprParser(ConfExpr &expr, const string &text) : m_expr(expr), m_text(text) {}
+
+    bool parse() {
+
+        m_ok = true;
+        m_depth = 0;
+        m_maxDepth = 0;
+
+        expression();
+        skipSpaces();
+
+        if (m_pos != m_text.size()) {
+            fail("unexpected \"" + m_text.substr(m_pos) + "\"");
+        }
+
+        if (m_ok && m_maxDepth > EXPRSTACK) {
+            fail("too deep");
+        }
+
+        return m_ok;
+    }
+
+private:
+
+    void fail(const string &what) {
+        if (m_ok) {
+            cout << ERRORMSGBLANK << "Wrong expression \"" << m_text
+                 << "\": " << what << "!\n";
+        }
+        m_ok = false;
+        m_pos = m_text.size();
+    }
+
+    void skipSpaces() {
+        while (m_pos < m_text.size() && isspace(static_cast<unsigned char>(m_text[m_pos]))) {
+            m_pos++;
+        }
+    }
+
+    bool accept(char c) {
+        skipSpaces();
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!accept(c)) {
+            fail(string("\"") + c + "\" expected");
+        }
+    }
+
+    // the stack depth is tracked to check it once
+    void emit(ConfExpr::Op op, uint32_t arg, int push) {
+
+        ConfExpr::Instr in;
+        in.op = op;
+        in.arg = arg;
+
+        m_expr.m_code.push_back(in);
+
+        m_depth += push;
+
+        if (m_depth > m_maxDepth) {
+            m_maxDepth = m_depth;
+        }
+    }
+
+    void constant(double value) {
+        emit(ConfExpr::CONST, m_expr.m_consts.size(), 1);
+        m_expr.m_consts.push_back(value);
+    }
+
+    bool number(double &value) {
+
+        skipSpaces();
+
+        const char *begin = m_text.c_str() + m_pos;
+        char *end = nullptr;
+
+        value = strtod(begin, &end);
+
+        if (end == begin) {
+            return false;
+        }
+
+        m_pos += end - begin;
+
+        return true;
+    }
+
+    string name() {
+
+        skipSpaces();
+
+        const size_t begin = m_pos;
+
+        while (m_pos < m_text.size() &&
+               (isalnum(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '_')) {
+            m_pos++;
+        }
+
+        return m_text.substr(begin, m_pos - begin);
+    }
+
+    void expression() {
+
+        term();
+
+        for (;;) {
+            if (accept('+')) {
+                term();
+                emit(ConfExpr::ADD, 0, -1);
+            }
+            else if (accept('-')) {
+                term();
+                emit(ConfExpr::SUB, 0, -1);
+            }
+            else {
+                return;
+            }
+        }
+    }
+
+    void term() {
+
+        unary();
+
+        for (;;) {
+            if (accept('*')) {
+                unary();
+                emit(ConfExpr::MUL, 0, -1);
+            }
+            else if (accept('/')) {
+                unary();
+                emit(ConfExpr::DIV, 0, -1);
+            }
+            else {
+                return;
+            }
+        }
+    }
+
+    void unary() {
+
+        if (accept('-')) {
+            unary();
+            emit(ConfExpr::NEG, 0, 0);
+        }
+        else {
+            power();
+        }
+    }
+
+    void power() {
+
+        primary();
+
+        if (accept('^')) {
+            unary();
+            emit(ConfExpr::POW, 0, -1);
+        }
+    }
+
+    void primary() {
+
+        double value = 0;
+
+        if (accept('(')) {
+            expression();
+            expect(')');
+            return;
+        }
+
+        skipSpaces();
+
+        if (m_pos < m_text.size() &&
+            (isdigit(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '.')) {
+
+            if (!number(value)) {
+                fail("wrong number");
+            }
+
+            constant(value);
+            return;
+        }
+
+        const string id = name();
+
+        if (id.empty()) {
+            fail("value expected");
+            return;
+        }
+
+        if (!accept('(')) {
+
+            const size_t key = Conf::keyIndex(id);
+
+            if (key == CONFFIELDS) {
+                fail("unknown key \"" + id + "\"");
+                return;
+            }
+
+            emit(ConfExpr::FIELD, key, 1);
+            return;
+        }
+
+        if (id == "lookup") {
+            lookup();
+            return;
+        }
+
+        ConfExpr::Op op = ConfExpr::SQRT;
+        size_t args = 1;
+
+        if (id == "sqrt") {
+            op = ConfExpr::SQRT;
+        }
+        else if (id == "exp") {
+            op = ConfExpr::EXP;
+        }
+        else if (id == "log") {
+            op = ConfExpr::LOG;
+        }
+        else if (id == "abs") {
+            op = ConfExpr::ABS;
+        }
+        else if (id == "min") {
+            op = ConfExpr::MIN;
+            args = 2;
+        }
+        else if (id == "max") {
+            op = ConfExpr::MAX;
+            args = 2;
+        }
+        else {
+            fail("unknown function \"" + id + "\"");
+            return;
+        }
+
+        expression();
+
+        if (args == 2) {
+            expect(',');
+            expression();
+        }
+
+        expect(')');
+
+        emit(op, 0, 1 - int(args));
+    }
+
+    void lookup() {
+
+        expression();
+
+        vector<double> points;
+
+        while (accept(',')) {
+
+            double x = 0;
+            double y = 0;
+
+            if (!number(x) || !accept(':') || !number(y)) {
+                fail("\"x:y\" expected in lookup");
+                return;
+            }
+
+            if (!points.empty() && !(x > points[points.size()-2])) {
+                fail("lookup x must increase");
+                return;
+            }
+
+            points.push_back(x);
+            points.push_back(y);
+        }
+
+        expect(')');
+
+        if (points.empty()) {
+            fail("empty lookup");
+            return;
+        }
+
+        emit(ConfExpr::LOOKUP, m_expr.m_tables.size(), 0);
+
+        m_expr.m_tables.push_back(m_expr.m_tableData.size());
+        m_expr.m_tableData.push_back(points.size() / 2);
+        m_expr.m_tableData.insert(m_expr.m_tableData.end(), points.begin(), points.end());
+    }
+
+    ConfExpr &m_expr;
+    const string &m_text;
+
+    size_t m_pos = 0;
+    bool   m_ok  = true;
+    int    m_depth = 0;
+    int    m_maxDepth = 0;
+
+};
+
+bool ConfExpr::add(size_t key, const string &text) {
+
+    Def def;
+    def.key = key;
+    def.begin = m_code.size();
+
+    ExprParser parser(*this, text);
+
+    if (!parser.parse()) {
+        return false;
+    }
+
+    def.end = m_code.size();
+
+    m_defs.push_back(def);
+
+    return true;
+}
+
+bool ConfExpr::compile() {
+
+    // depth-first order of the dependencies, with the cycles found by the
+    // keys on the path
+
+    vector<int> defOf(CONFFIELDS, -1);
+
+    for (size_t d=0; d<m_defs.size(); d++) {
+        defOf[m_defs[d].key] = d;
+    }
+
+    vector<int> state(m_defs.size(), 0); // 1 on the path, 2 done
+    vector<Def> ordered;
+    ordered.reserve(m_defs.size());
+
+    struct Frame {
+        size_t def;
+        size_t pc;
+    };
+
+    for (size_t root=0; root<m_defs.size(); root++) {
+
+        if (state[root] != 0) {
+            continue;
+        }
+
+        vector<Frame> path(1, Frame{root, m_defs[root].begin});
+        state[root] = 1;
+
+        while (!path.empty()) {
+
+            Frame &f = path.back();
+            const Def &def = m_defs[f.def];
+
+            if (f.pc == def.end) {
+                state[f.def] = 2;
+                ordered.push_back(def);
+                path.pop_back();
+                continue;
+            }
+
+            const Instr &in = m_code[f.pc++];
+
+            if (in.op != FIELD || defOf[in.arg] < 0) {
+                continue;
+            }
+
+            const size_t dep = defOf[in.arg];
+
+            if (state[dep] == 1) {
+                cout << ERRORMSGBLANK << "The expressions of \"" << Conf::key(m_defs[dep].key)
+                     << "\" and \"" << Conf::key(def.key) << "\" depend on each other!\n";
+                return false;
+            }
+
+            if (state[dep] == 0) {
+                state[dep] = 1;
+                path.push_back(Frame{dep, m_defs[dep].begin});
+            }
+        }
+    }
+
+    m_defs.swap(ordered);
+
+    return true;
+}
+
+void ConfExpr::evaluate(Conf &conf, uint64_t fixed) const {
+
+    double stack[EXPRSTACK];
+
+    for (size_t d=0; d<m_defs.size(); d++) {
+
+        const Def &def = m_defs[d];
+
+        if (fixed & (uint64_t(1) << def.key)) {
+            continue;
+        }
+
+        size_t sp = 0;
+
+        for (size_t pc=def.begin; pc<def.end; pc++) {
+
+            const Instr &in = m_code[pc];
+
+            switch (in.op) {
+            case CONST:
+                stack[sp++] = m_consts[in.arg];
+                break;
+            case FIELD:
+                stack[sp++] = conf.value(in.arg);
+                break;
+            case ADD:
+                sp--;
+                stack[sp-1] += stack[sp];
+                break;
+            case SUB:
+                sp--;
+                stack[sp-1] -= stack[sp];
+                break;
+            case MUL:
+                sp--;
+                stack[sp-1] *= stack[sp];
+                break;
+            case DIV:
+                sp--;
+                stack[sp-1] /= stack[sp];
+                break;
+            case POW:
+                sp--;
+                stack[sp-1] = pow(stack[sp-1], stack[sp]);
+                break;
+            case NEG:
+                stack[sp-1] = -stack[sp-1];
+                break;
+            case SQRT:
+                stack[sp-1] = sqrt(stack[sp-1]);
+                break;
+            case EXP:
+                stack[sp-1] = exp(stack[sp-1]);
+                break;
+            case LOG:
+                stack[sp-1] = log(stack[sp-1]);
+                break;
+            case ABS:
+                stack[sp-1] = fabs(stack[sp-1]);
+                break;
+            case MIN:
+                sp--;
+                stack[sp-1] = (stack[sp] < stack[sp-1]) ? stack[sp] : stack[sp-1];
+                break;
+            case MAX:
+                sp--;
+                stack[sp-1] = (stack[sp] > stack[sp-1]) ? stack[sp] : stack[sp-1];
+                break;
+            case LOOKUP: {
+
+                const double *t = m_tableData.data() + m_tables[in.arg];
+                const size_t points = t[0];
+                const double *xy = t + 1;
+                const double x = stack[sp-1];
+
+                if (x <= xy[0] || points == 1) {
+                    stack[sp-1] = xy[1];
+                }
+                else if (x >= xy[2 * (points - 1)]) {
+                    stack[sp-1] = xy[2 * (points - 1) + 1];
+                }
+                else {
+
+                    size_t i = 1;
+
+                    while (xy[2 * i] < x) {
+                        i++;
+                    }
+
+                    const double x0 = xy[2 * (i - 1)];
+                    const double y0 = xy[2 * (i - 1) + 1];
+
+                    stack[sp-1] = y0 + (xy[2 * i + 1] - y0) * (x - x0) / (xy[2 * i] - x0);
+                }
+
+                break;
+            }
+            }
+        }
+
+        conf.setValue(def.key, stack[0]);
+    }
+}
@@ -0,0 +1,87 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: expr.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXPR_HPP
+#define EXPR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Conf;
+
+// Expression-valued fields of the configuration, e.g.
+//
+//   pk=100 + 0.045 * n
+//   alpha=lookup(n, 1200:1.3, 1600:1.5, 2200:1.7)
+//   teta=max(8, 0.5 * sqrt(n) - 6)
+//
+// The expressions have + - * / ^, parentheses, numbers, the keys of the
+// other fields and the functions sqrt, exp, log, abs, min, max and
+// lookup(x, x1:y1, x2:y2, ...), the linear interpolation in the table
+// clamped at its ends. They are compiled once into a stack bytecode in
+// the order of their dependencies, so evaluate() neither parses nor
+// allocates.
+class ConfExpr {
+
+public:
+
+    // false with a message if the expression is wrong
+    bool add(size_t key, const std::string &text);
+
+    // orders the expressions by their dependencies
+    bool compile();
+
+    bool empty() const { return m_defs.empty(); }
+
+    // the values of the expressions of the keys which are not fixed (bit
+    // per key), from the current values of the others
+    void evaluate(Conf &, uint64_t fixed) const;
+
+private:
+
+    enum Op : uint8_t {
+        CONST, FIELD, ADD, SUB, MUL, DIV, POW, NEG,
+        SQRT, EXP, LOG, ABS, MIN, MAX, LOOKUP
+    };
+
+    struct Instr {
+        Op       op  = CONST;
+        uint32_t arg = 0;
+    };
+
+    struct Def {
+        size_t key   = 0;
+        size_t begin = 0;
+        size_t end   = 0;
+    };
+
+    friend class ExprParser;
+
+    std::vector<Instr>  m_code;
+    std::vector<double> m_consts;
+    std::vector<size_t> m_tables; // [points, x1, y1, ...] in m_tableData
+    std::vector<double> m_tableData;
+    std::vector<Def>    m_defs;
+
+};
+
+#endif // EXPR_HPP
@@ -0,0 +1,145 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: filter.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filter.hpp"
+#include "const.hpp"
+#include "auxf.hpp"
+#include "store.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <regex>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::regex;
+using std::smatch;
+using std::regex_match;
+using std::regex_replace;
+using std::numeric_limits;
+
+bool Filter::parse(const string &filter) {
+
+    m_conds.clear();
+
+    const string list = regex_replace(filter, regex("[ ]+and[ ]+"), ELEMDELIMITER);
+    const regex condRegex("^[ ]*([A-Za-z_][A-Za-z_0-9]*)[ ]*(<=|>=|==|<|>|=)[ ]*([^ ]+)[ ]*$");
+
+    vector<string> elem;
+    splitString(list, elem, ELEMDELIMITER);
+
+    for (size_t i=0; i<elem.size(); i++) {
+
+        smatch m;
+
+        if (!regex_match(elem[i], m, condRegex)) {
+            cout << ERRORMSGBLANK << "Wrong condition \"" << elem[i] << "\"!\n";
+            return false;
+        }
+
+        Cond cond;
+
+        cond.col = storeColumnIndex(m[1]);
+
+        if (cond.col == STORECOLUMNS) {
+            cout << ERRORMSGBLANK << "Unknown column \"" << m[1] << "\"!\n";
+            return false;
+        }
+
+        const string op = m[2];
+
+        if      (op == "<")  { cond.op = LESS;         }
+        else if (op == "<=") { cond.op = LESSEQUAL;    }
+        else if (op == ">")  { cond.op = GREATER;      }
+        else if (op == ">=") { cond.op = GREATEREQUAL; }
+        else                 { cond.op = EQUAL;        }
+
+        cond.value = stringToDouble(m[3]);
+
+        m_conds.push_back(cond);
+    }
+
+    return true;
+}
+
+bool Filter::mayMatch(const double *lo, const double *hi) const {
+
+    for (size_t k=0; k<m_conds.size(); k++) {
+        if (!mayMatch(m_conds[k], lo[m_conds[k].col], hi[m_conds[k].col])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Filter::matches(const double *cols) const {
+
+    for (size_t k=0; k<m_conds.size(); k++) {
+
+        const double x = cols[m_conds[k].col];
+
+        if (!mayMatch(m_conds[k], x, x)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+double Filter::violation(const double *cols) const {
+
+    double sum = 0;
+
+    for (size_t k=0; k<m_conds.size(); k++) {
+
+        const Cond &cond = m_conds[k];
+        const double x = cols[cond.col];
+
+        if (std::isnan(x)) {
+            return numeric_limits<double>::infinity();
+        }
+
+        if (!mayMatch(cond, x, x)) {
+            sum += fabs(x - cond.value) / std::max(1.0, fabs(cond.value));
+        }
+    }
+
+    return sum;
+}
+
+// whether any value of [lo, hi] may satisfy the condition
+bool Filter::mayMatch(const Cond &cond, double lo, double hi) {
+
+    switch (cond.op) {
+    case LESS:         return lo <  cond.value;
+    case LESSEQUAL:    return lo <= cond.value;
+    case GREATER:      return hi >  cond.value;
+    case GREATEREQUAL: return hi >= cond.value;
+    case EQUAL:        return lo <= cond.value && cond.value <= hi;
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: filter.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Conjunction of the conditions "column op value" over the columns of
+// a case, the inputs and then the outputs (see storeColumnName()). The
+// conditions are delimited by "," or "and", op is one of < <= > >= =,
+// e.g. "ge<210,P_fire_max<16000".
+class Filter {
+
+public:
+
+    bool parse(const std::string &);
+
+    bool empty() const { return m_conds.empty(); }
+
+    // whether any case with the columns within [lo, hi] may match
+    bool mayMatch(const double *lo, const double *hi) const;
+    bool matches(const double *cols) const;
+
+    // sum of the violations of the conditions relative to their values,
+    // 0 if the case matches; NaN columns violate infinitely
+    double violation(const double *cols) const;
+
+private:
+
+    enum Op { LESS, LESSEQUAL, GREATER, GREATEREQUAL, EQUAL };
+
+    struct Cond {
+        size_t col   = 0;
+        Op     op    = EQUAL;
+        double value = 0;
+    };
+
+    static bool mayMatch(const Cond &, double lo, double hi);
+
+    std::vector<Cond> m_conds;
+
+};
+
+#endif // FILTER_HPP
@@ -0,0 +1,391 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: journal.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "journal.hpp"
+#include "const.hpp"
+#include "auxf.hpp"
+#include "result.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+using std::sort;
+using std::unique;
+using std::chrono::steady_clock;
+using std::chrono::seconds;
+
+namespace {
+
+struct JournalHeader {
+    char     magic[8];
+    char     source[16];
+    uint64_t cases;
+    uint64_t recordSize;
+};
+
+struct JournalRecord {
+    Result   res;
+    uint64_t check;
+};
+
+const char journalMagic[8]    = { 'V', 'I', 'B', 'E', '7', '2', 'J', '1' };
+const char checkpointMagic[8] = { 'V', 'I', 'B', 'E', '7', '2', 'C', '1' };
+
+uint64_t recordCheck(const Result &res) {
+    return
+        hashBytes(&res, sizeof(Result));
+}
+
+JournalHeader makeHeader(const char *magic, const string &source, size_t cases) {
+
+    JournalHeader header;
+
+    memcpy(header.magic, magic, sizeof(header.magic));
+    memset(header.source, 0, sizeof(header.source));
+    memcpy(header.source, source.data(), std::min(source.size(), sizeof(header.source)));
+    header.cases = cases;
+    header.recordSize = sizeof(JournalRecord);
+
+    return header;
+}
+
+bool sameHeader(const JournalHeader &a, const JournalHeader &b) {
+    return
+        memcmp(&a, &b, sizeof(JournalHeader)) == 0;
+}
+
+bool lessIndex(const Result &a, const Result &b) {
+    return a.index < b.index;
+}
+
+bool sameIndex(const Result &a, const Result &b) {
+    return a.index == b.index;
+}
+
+}
+
+Journal::Journal(const string &filename,
+                 const string &source,
+                 size_t cases) {
+    m_filename = filename;
+    m_ckptFilename = filename + ".ckpt";
+    m_source = source;
+    m_cases = cases;
+}
+
+Journal::~Journal() {
+
+    if (m_file) {
+        fclose(m_file);
+    }
+}
+
+bool Journal::open(size_t workers) {
+
+    m_buffers.assign(workers, vector<Result>());
+
+    for (size_t w=0; w<workers; w++) {
+        m_buffers[w].reserve(JOURNALBATCH);
+    }
+
+    m_bits.assign((m_cases + 63) / 64, 0);
+
+    uint64_t valid = sizeof(JournalHeader);
+    bool fresh = true;
+
+    FILE *f = fopen(m_filename.c_str(), "rb");
+
+    if (f) {
+
+        if (checkHeader(f)) {
+
+            fresh = false;
+
+            uint64_t offset = 0;
+
+            if (!readCheckpoint(offset) || fseek(f, offset, SEEK_SET) != 0) {
+                m_bits.assign(m_bits.size(), 0);
+                offset = sizeof(JournalHeader);
+                fseek(f, offset, SEEK_SET);
+            }
+
+            // the records after the checkpoint up to the first torn one
+
+            JournalRecord rec;
+
+            while (fread(&rec, sizeof(rec), 1, f) == 1 &&
+                   rec.check == recordCheck(rec.res) &&
+                   rec.res.index < m_cases) {
+                m_bits[rec.res.index / 64] |= uint64_t(1) << (rec.res.index % 64);
+                offset += sizeof(rec);
+            }
+
+            valid = offset;
+        }
+        else {
+            cout << WARNMSGBLANK << "Journal \"" << m_filename
+                 << "\" belongs to another run. It will be started anew.\n";
+        }
+
+        fclose(f);
+    }
+
+    if (fresh) {
+
+        std::remove(m_ckptFilename.c_str());
+
+        f = fopen(m_filename.c_str(), "wb");
+
+        if (!f || !writeHeader(f)) {
+            cout << ERRORMSGBLANK << "Can not open file \""
+                 << m_filename << "\" to write!\n";
+            if (f) {
+                fclose(f);
+            }
+            return false;
+        }
+
+        fclose(f);
+    }
+    else {
+        std::error_code err;
+        std::filesystem::resize_file(m_filename, valid, err);
+    }
+
+    m_file = fopen(m_filename.c_str(), "ab");
+
+    if (!m_file) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << m_filename << "\" to write!\n";
+        return false;
+    }
+
+    m_offset = valid;
+    m_resumed = m_bits;
+    m_completed = 0;
+
+    for (size_t i=0; i<m_bits.size(); i++) {
+        for (uint64_t b=m_bits[i]; b; b&=b-1) {
+            m_completed++;
+        }
+    }
+
+    m_lastCheckpoint = steady_clock::now();
+
+    return true;
+}
+
+bool Journal::done(size_t idx) const {
+    return
+        (m_resumed[idx / 64] >> (idx % 64)) & 1;
+}
+
+void Journal::append(size_t worker, const Result &res) {
+
+    vector<Result> &buffer = m_buffers[worker];
+
+    buffer.push_back(res);
+
+    if (buffer.size() >= JOURNALBATCH) {
+        lock_guard<mutex> guard(m_lock);
+        flush(buffer);
+    }
+}
+
+bool Journal::close() {
+
+    bool ok = true;
+
+    lock_guard<mutex> guard(m_lock);
+
+    if (!m_file) {
+        return false;
+    }
+
+    for (size_t w=0; w<m_buffers.size(); w++) {
+        ok = flush(m_buffers[w]) && ok;
+    }
+
+    ok = checkpoint() && ok;
+
+    ok = (fclose(m_file) == 0) && ok;
+    m_file = nullptr;
+
+    return ok;
+}
+
+bool Journal::readAll(vector<Result> &results) const {
+
+    FILE *f = fopen(m_filename.c_str(), "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    if (!checkHeader(f)) {
+        fclose(f);
+        return false;
+    }
+
+    JournalRecord rec;
+
+    while (fread(&rec, sizeof(rec), 1, f) == 1 &&
+           rec.check == recordCheck(rec.res) &&
+           rec.res.index < m_cases) {
+        results.push_back(rec.res);
+    }
+
+    fclose(f);
+
+    sort(results.begin(), results.end(), lessIndex);
+    results.erase(unique(results.begin(), results.end(), sameIndex), results.end());
+
+    return true;
+}
+
+void Journal::remove() const {
+    std::remove(m_filename.c_str());
+    std::remove(m_ckptFilename.c_str());
+}
+
+bool Journal::flush(vector<Result> &buffer) {
+
+    if (buffer.empty()) {
+        return true;
+    }
+
+    vector<JournalRecord> recs(buffer.size());
+
+    for (size_t i=0; i<buffer.size(); i++) {
+        recs[i].res = buffer[i];
+        recs[i].check = recordCheck(buffer[i]);
+    }
+
+    // the records reach the OS before they are counted as done, so
+    // a checkpoint never refers to the records not written yet
+
+    const bool ok =
+        fwrite(recs.data(), sizeof(JournalRecord), recs.size(), m_file) == recs.size() &&
+        fflush(m_file) == 0;
+
+    if (!ok) {
+        cout << ERRORMSGBLANK << "Can not write file \"" << m_filename << "\"!\n";
+        buffer.clear();
+        return false;
+    }
+
+    for (size_t i=0; i<buffer.size(); i++) {
+        m_bits[buffer[i].index / 64] |= uint64_t(1) << (buffer[i].index % 64);
+    }
+
+    m_offset += recs.size() * sizeof(JournalRecord);
+    m_written += recs.size() * sizeof(JournalRecord);
+    buffer.clear();
+
+    if (steady_clock::now() - m_lastCheckpoint >= seconds(CHECKPOINTSEC)) {
+        return checkpoint();
+    }
+
+    return true;
+}
+
+bool Journal::checkpoint() {
+
+    m_lastCheckpoint = steady_clock::now();
+
+    if (!syncFile(m_file)) {
+        return false;
+    }
+
+    const string tmpFilename = m_ckptFilename + ".tmp";
+
+    FILE *f = fopen(tmpFilename.c_str(), "wb");
+
+    if (!f) {
+        cout << WARNMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    const JournalHeader header = makeHeader(checkpointMagic, m_source, m_cases);
+
+    bool ok =
+        fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(&m_offset, sizeof(m_offset), 1, f) == 1 &&
+        fwrite(m_bits.data(), sizeof(uint64_t), m_bits.size(), f) == m_bits.size() &&
+        syncFile(f);
+
+    ok = (fclose(f) == 0) && ok;
+
+    return
+        ok && replaceFile(tmpFilename, m_ckptFilename);
+}
+
+bool Journal::readCheckpoint(uint64_t &offset) {
+
+    FILE *f = fopen(m_ckptFilename.c_str(), "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    JournalHeader header;
+
+    const bool ok =
+        fread(&header, sizeof(header), 1, f) == 1 &&
+        sameHeader(header, makeHeader(checkpointMagic, m_source, m_cases)) &&
+        fread(&offset, sizeof(offset), 1, f) == 1 &&
+        fread(m_bits.data(), sizeof(uint64_t), m_bits.size(), f) == m_bits.size() &&
+        offset >= sizeof(JournalHeader) &&
+        offset <= std::filesystem::file_size(m_filename);
+
+    fclose(f);
+
+    return ok;
+}
+
+bool Journal::writeHeader(FILE *f) const {
+
+    const JournalHeader header = makeHeader(journalMagic, m_source, m_cases);
+
+    return
+        fwrite(&header, sizeof(header), 1, f) == 1;
+}
+
+bool Journal::checkHeader(FILE *f) const {
+
+    JournalHeader header;
+
+    return
+        fread(&header, sizeof(header), 1, f) == 1 &&
+        sameHeader(header, makeHeader(journalMagic, m_source, m_cases));
+}
@@ -0,0 +1,93 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: journal.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "result.hpp"
+
+// Append-only journal of the calculated cases of a multi-case run.
+//
+// Every record carries its checksum, so a torn tail left by a killed
+// process is detected and cut off. The checkpoint file holds the set of
+// completed cases and the length of the journal synced to disk with it;
+// it is replaced atomically, so the recovery reads it and scans only the
+// records appended after it. The files are in the host byte order.
+class Journal {
+
+public:
+
+    Journal(const std::string &filename,
+            const std::string &source,
+            size_t cases);
+    ~Journal();
+
+    // opens or recovers the journal; the cases found in it are done
+    bool open(size_t workers);
+
+    size_t completed() const { return m_completed; }
+
+    // bytes of the records written by this run; may be read from any thread
+    uint64_t written() const { return m_written; }
+    bool done(size_t) const;
+
+    // buffered per worker, so the workers do not wait for each other
+    void append(size_t worker, const Result &);
+
+    bool close();
+    bool readAll(std::vector<Result> &) const;
+    void remove() const;
+
+private:
+
+    bool flush(std::vector<Result> &);
+    bool checkpoint();
+    bool readCheckpoint(uint64_t &);
+    bool writeHeader(FILE *) const;
+    bool checkHeader(FILE *) const;
+
+    std::string m_filename;
+    std::string m_ckptFilename;
+    std::string m_source;
+    size_t      m_cases     = 0;
+    size_t      m_completed = 0;
+
+    FILE *m_file = nullptr;
+    std::mutex m_lock;
+
+    std::vector<std::vector<Result>> m_buffers;
+    std::vector<uint64_t> m_resumed; // done before this run, read-only
+    std::vector<uint64_t> m_bits;    // done, guarded by m_lock
+    uint64_t m_offset = 0;           // end of the written records
+    std::atomic<uint64_t> m_written{0};
+
+    std::chrono::steady_clock::time_point m_lastCheckpoint;
+
+};
+
+#endif // JOURNAL_HPP
@@ -26,17 +26,79 @@
 */
 
 #include <iostream>
+#include <fstream>
 #include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
 
 #include "prgid.hpp"
 #include "const.hpp"
 #include "conf.hpp"
 #include "calc.hpp"
+#include "opts.hpp"
+#include "batch.hpp"
+#include "merge.hpp"
+#include "store.hpp"
+#include "solve.hpp"
+#include "optim.hpp"
+#include "surrogate.hpp"
+#include "refine.hpp"
+#include "wcet.hpp"
+#include "watch.hpp"
+#include "analyze.hpp"
+#include "result.hpp"
+#include "auxf.hpp"
 
 using std::unique_ptr;
 using std::shared_ptr;
 using std::cout;
 using std::cin;
+using std::ofstream;
+using std::vector;
+using std::string;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace {
+
+bool queryStore(const Opts &opts) {
+
+    string reportFilename = opts.val_output();
+
+    if (reportFilename.empty()) {
+        reportFilename = string(PRGNAME) + "_query_" + currDateTime() + ".csv";
+    }
+
+    ofstream fout(reportFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << reportFilename << "\" to write!\n";
+        return false;
+    }
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    Store store(opts.val_storefile());
+    size_t matched = 0;
+
+    if (!store.query(opts.val_filter(), fout, matched)) {
+        return false;
+    }
+
+    const duration<double> elapsed = steady_clock::now() - start;
+
+    fout.close();
+
+    cout << MSGBLANK << matched << " cases selected in "
+         << elapsed.count() * 1000.0 << " ms.\n";
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\" created.\n\n";
+
+    return true;
+}
+
+}
 
 int main(int argc, char **argv) {
 
@@ -47,6 +109,30 @@ int main(int argc, char **argv) {
          << "Author's blog (RU): " << PRGAUTHORSBLOG << "\n\n"
          << PRGLICENSEINFORMATION << "\n\n";
 
+    shared_ptr<Opts> opts(new Opts());
+
+    if (!opts->readCommandLine(argc, argv)) {
+        return 1;
+    }
+
+    if (opts->val_help()) {
+        return 0;
+    }
+
+    if (opts->val_merge()) {
+        unique_ptr<Merge> merge(new Merge(opts));
+        return merge->run() ? 0 : 1;
+    }
+
+    if (opts->val_query()) {
+        return queryStore(*opts) ? 0 : 1;
+    }
+
+    if (opts->val_map()) {
+        unique_ptr<Surrogate> surrogate(new Surrogate(nullptr, opts));
+        return surrogate->query() ? 0 : 1;
+    }
+
     bool start = true;
 
     shared_ptr<Conf> conf(new Conf());
@@ -56,10 +142,137 @@ int main(int argc, char **argv) {
         start = false;
     }
 
+    if (opts->val_analyze()) {
+
+        if (start) {
+            unique_ptr<Analyze> analyze(new Analyze(conf, opts));
+            start = analyze->run();
+            if (!start) {
+                cout << ERRORMSGBLANK << "Analysis failed!\n";
+            }
+        }
+
+        return start ? 0 : 1;
+    }
+
+    if (opts->val_wcet()) {
+
+        if (start) {
+            unique_ptr<Wcet> wcet(new Wcet(conf, opts));
+            start = wcet->run();
+        }
+
+        return start ? 0 : 1;
+    }
+
+    if (opts->val_watch()) {
+
+        if (start) {
+            unique_ptr<Watch> watch(new Watch(conf, opts));
+            start = watch->run();
+        }
+
+        return start ? 0 : 1;
+    }
+
+    if (opts->val_buildmap()) {
+
+        if (start) {
+            unique_ptr<Surrogate> surrogate(new Surrogate(conf, opts));
+            start = surrogate->build();
+            if (!start) {
+                cout << ERRORMSGBLANK << "Calculation failed!\n";
+            }
+        }
+
+        return start ? 0 : 1;
+    }
+
+    if (opts->val_optim()) {
+
+        if (start) {
+            unique_ptr<Optim> optim(new Optim(conf, opts));
+            start = optim->run();
+            if (!start) {
+                cout << ERRORMSGBLANK << "Calculation failed!\n";
+            }
+        }
+
+        return start ? 0 : 1;
+    }
+
+    if (opts->val_refine()) {
+
+        if (start) {
+            unique_ptr<Refine> refine(new Refine(conf, opts));
+            start = refine->run();
+            if (!start) {
+                cout << ERRORMSGBLANK << "Calculation failed!\n";
+            }
+        }
+
+        return start ? 0 : 1;
+    }
+
+    if (opts->val_solve()) {
+
+        if (start) {
+            unique_ptr<Solve> solve(new Solve(conf, opts));
+            start = solve->run();
+            if (!start) {
+                cout << ERRORMSGBLANK << "Calculation failed!\n";
+            }
+        }
+
+        return start ? 0 : 1;
+    }
+
+    // multi-case runs are not interactive
+    if (opts->val_sweep()) {
+
+        if (start) {
+            unique_ptr<Batch> batch(new Batch(conf, opts));
+            start = batch->run();
+            if (!start) {
+                cout << ERRORMSGBLANK << "Calculation failed!\n";
+            }
+        }
+
+        return start ? 0 : 1;
+    }
+
     if (start) {
         unique_ptr<Calc> calc(new Calc(conf));
-        if (calc->calculate()) {
+        calc->setParareal(opts->val_parareal());
+        calc->setThreads(opts->val_threads());
+        size_t evals = 0;
+        const bool done = opts->val_closed() ? calc->calculateClosed(evals)
+                                             : calc->calculate();
+        if (opts->val_closed()) {
+            cout << MSGBLANK << "Closed cycle: tr = " << conf->val_tr() << " after "
+                 << evals << " calculations" << (done ? "" : ", not converged") << ".\n\n";
+        }
+        if (opts->val_parareal()) {
+            cout << MSGBLANK << "Parareal fire phase: " << calc->pararealIterations()
+                 << " iterations.\n\n";
+        }
+        if (done) {
+
             calc->createReport();
+
+            if (opts->val_store()) {
+
+                vector<Result> results(1);
+                conf->values(results[0].in);
+                calc->outputs(results[0].out);
+
+                uint64_t run = 0;
+
+                if (Store(opts->val_storefile()).append(results, run)) {
+                    cout << MSGBLANK << "Stored as run " << run << " in \""
+                         << opts->val_storefile() << "\".\n\n";
+                }
+            }
         }
         else {
             cout << ERRORMSGBLANK << "Calculation failed!\n";
@@ -0,0 +1,57 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: mapfile.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAPFILE_HPP
+#define MAPFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The pages are read by the OS
+// on demand, so only the touched parts of a large file are ever loaded.
+class MapFile {
+
+public:
+
+    MapFile() = default;
+    ~MapFile();
+
+    MapFile(const MapFile &) = delete;
+    MapFile &operator=(const MapFile &) = delete;
+
+    bool open(const std::string &);
+    void close();
+
+    const char *data() const { return m_data; }
+    size_t      size() const { return m_size; }
+
+private:
+
+    const char *m_data = nullptr;
+    size_t      m_size = 0;
+
+#ifdef _WIN32
+    void *m_file    = nullptr;
+    void *m_mapping = nullptr;
+#endif
+
+};
+
+#endif // MAPFILE_HPP
@@ -0,0 +1,260 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: merge.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "merge.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+struct Partial {
+    string filename;
+    unique_ptr<ifstream> fin;
+    string source;
+    size_t cases  = 0;
+    size_t shard  = 0;
+    size_t shards = 0;
+    string header;
+};
+
+bool nextLine(ifstream &fin, string &s) {
+
+    while (getline(fin, s)) {
+
+        if (!s.empty() && s[s.size()-1] == '\r') {
+            s.erase(s.size()-1);
+        }
+
+        if (!s.empty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// the comment block with the shard description and the column header
+bool readPartialHeader(Partial &part) {
+
+    string s;
+    vector<string> elem;
+
+    while (nextLine(*part.fin, s)) {
+
+        if (s.compare(0, 2, "//") != 0) {
+            part.header = s;
+            return part.shards > 0;
+        }
+
+        elem.clear();
+        splitString(s.substr(2), elem, PARAMDELIMITER);
+
+        if (elem.size() != 2) {
+            continue;
+        }
+
+        const size_t first = elem[0].find_first_not_of(' ');
+
+        if (first == string::npos) {
+            continue;
+        }
+
+        const string key = elem[0].substr(first);
+
+        if (key == "source") {
+            part.source = elem[1];
+        }
+        else if (key == "cases") {
+            part.cases = strtoull(elem[1].c_str(), nullptr, 10);
+        }
+        else if (key == "shard") {
+
+            vector<string> shard;
+            splitString(elem[1], shard, "/");
+
+            if (shard.size() == 2) {
+                part.shard = strtoull(shard[0].c_str(), nullptr, 10);
+                part.shards = strtoull(shard[1].c_str(), nullptr, 10);
+            }
+        }
+    }
+
+    return false;
+}
+
+}
+
+Merge::Merge(const shared_ptr<Opts> &opts) {
+    m_opts = opts;
+}
+
+bool Merge::run() const {
+
+    const vector<string> &files = m_opts->val_mergefiles();
+
+    if (files.empty()) {
+        cout << ERRORMSGBLANK << "No partial result files to merge!\n";
+        return false;
+    }
+
+    vector<Partial> parts(files.size());
+
+    for (size_t i=0; i<files.size(); i++) {
+
+        Partial &part = parts[i];
+
+        part.filename = files[i];
+        part.fin.reset(new ifstream(files[i]));
+
+        if (!*part.fin) {
+            cout << ERRORMSGBLANK << "Can not open file \""
+                 << files[i] << "\" to read!\n";
+            return false;
+        }
+
+        if (!readPartialHeader(part) ||
+            part.shard == 0 || part.shard > part.shards) {
+            cout << ERRORMSGBLANK << "File \"" << files[i]
+                 << "\" is not a partial result file!\n";
+            return false;
+        }
+
+        if (part.source != parts[0].source ||
+            part.cases  != parts[0].cases  ||
+            part.shards != parts[0].shards ||
+            part.header != parts[0].header) {
+            cout << ERRORMSGBLANK << "File \"" << files[i]
+                 << "\" belongs to another run than \"" << files[0] << "\"!\n";
+            return false;
+        }
+    }
+
+    const size_t shards = parts[0].shards;
+    const size_t cases = parts[0].cases;
+
+    vector<Partial *> byShard(shards, nullptr);
+
+    for (size_t i=0; i<parts.size(); i++) {
+
+        Partial *&slot = byShard[parts[i].shard - 1];
+
+        if (slot) {
+            cout << ERRORMSGBLANK << "Shard " << parts[i].shard << " is given twice: \""
+                 << slot->filename << "\" and \"" << parts[i].filename << "\"!\n";
+            return false;
+        }
+
+        slot = &parts[i];
+    }
+
+    for (size_t k=0; k<shards; k++) {
+        if (!byShard[k]) {
+            cout << ERRORMSGBLANK << "Shard " << k + 1 << "/" << shards
+                 << " is missing!\n";
+            return false;
+        }
+    }
+
+    string reportFilename = m_opts->val_output();
+
+    if (reportFilename.empty()) {
+        reportFilename = string(PRGNAME) + "_sweep_" + currDateTime() + ".csv";
+    }
+
+    const string tmpFilename = reportFilename + ".tmp";
+
+    ofstream fout(tmpFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    fout << parts[0].header << "\n";
+
+    // the shards are interleaved, so the ordered result is read from them
+    // in turn and every case is checked on the way
+
+    string row;
+    bool complete = true;
+
+    for (size_t i=0; i<cases && complete; i++) {
+
+        Partial &part = *byShard[i % shards];
+
+        if (!nextLine(*part.fin, row)) {
+            cout << ERRORMSGBLANK << "Shard " << part.shard << "/" << shards
+                 << " is incomplete: case " << i << " is missing!\n";
+            complete = false;
+        }
+        else if (strtoull(row.c_str(), nullptr, 10) != i) {
+            cout << ERRORMSGBLANK << "Shard " << part.shard << "/" << shards
+                 << " is inconsistent: case " << i << " expected!\n";
+            complete = false;
+        }
+        else {
+            fout << row << "\n";
+        }
+    }
+
+    for (size_t k=0; k<shards && complete; k++) {
+        if (nextLine(*byShard[k]->fin, row)) {
+            cout << ERRORMSGBLANK << "Shard " << k + 1 << "/" << shards
+                 << " has more cases than expected!\n";
+            complete = false;
+        }
+    }
+
+    fout.close();
+
+    if (!complete) {
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+
+    if (!fout || !replaceFile(tmpFilename, reportFilename)) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << reportFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << cases << " cases of " << shards
+         << " shard(s) merged into file \"" << reportFilename << "\".\n\n";
+
+    return true;
+}
@@ -0,0 +1,45 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: merge.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MERGE_HPP
+#define MERGE_HPP
+
+#include <memory>
+
+#include "opts.hpp"
+
+// Merge of the partial result files of the shards into the result file
+// of the whole run. The shards must come from the same source data and
+// cover every case exactly once.
+class Merge {
+
+public:
+
+    Merge(const std::shared_ptr<Opts> &opts);
+
+    bool run() const;
+
+private:
+
+    std::shared_ptr<Opts> m_opts;
+
+};
+
+#endif // MERGE_HPP
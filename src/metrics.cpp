@@ -0,0 +1,340 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: metrics.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "metrics.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::ostringstream;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::function;
+using std::chrono::steady_clock;
+using std::chrono::seconds;
+using std::chrono::duration;
+
+namespace {
+
+// 4 buckets per octave, from 1 ns to about 18 min
+const double bucketsPerOctave = METRICSBUCKETS / 40.0;
+
+size_t bucket(uint64_t ns) {
+
+    if (ns <= 1) {
+        return 0;
+    }
+
+    const size_t b = log2(double(ns)) * bucketsPerOctave;
+
+    return
+        (b < METRICSBUCKETS) ? b : METRICSBUCKETS - 1;
+}
+
+// the middle of the bucket, in seconds
+double bucketValue(size_t b) {
+    return
+        pow(2.0, (b + 0.5) / bucketsPerOctave) * 1e-9;
+}
+
+}
+
+Metrics::Metrics(const string &filename, size_t workers, size_t jobs) {
+
+    m_filename = filename;
+    m_jobs = jobs;
+
+    for (size_t w=0; w<workers; w++) {
+        m_stats.push_back(std::unique_ptr<WorkerStats>(new WorkerStats()));
+    }
+}
+
+Metrics::~Metrics() {
+    stop();
+}
+
+void Metrics::setQueues(const function<void(vector<size_t> &)> &queues) {
+    lock_guard<mutex> guard(m_lock);
+    m_queues = queues;
+}
+
+void Metrics::setBytes(const function<uint64_t()> &bytes) {
+    m_bytesSource = bytes;
+}
+
+void Metrics::start() {
+
+    m_start = steady_clock::now();
+    m_last = m_start;
+    m_stop = false;
+
+    write(false);
+
+    m_thread = std::thread(&Metrics::loop, this);
+}
+
+void Metrics::stop() {
+
+    if (!m_thread.joinable()) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(m_lock);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+    m_thread.join();
+
+    write(true);
+}
+
+void Metrics::evaluated(size_t worker, uint64_t ns) {
+
+    WorkerStats &s = *m_stats[worker];
+
+    s.evals.fetch_add(1, std::memory_order_relaxed);
+    s.busy.fetch_add(ns, std::memory_order_relaxed);
+    s.hist[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::cached(size_t worker) {
+    m_stats[worker]->cached.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::addBytes(uint64_t bytes) {
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::loop() {
+
+    unique_lock<mutex> guard(m_lock);
+
+    while (!m_stop) {
+
+        m_wake.wait_for(guard, seconds(METRICSSEC));
+
+        if (m_stop) {
+            break;
+        }
+
+        guard.unlock();
+
+        if (!write(false)) {
+            cout << WARNMSGBLANK << "Can not write file \""
+                 << m_filename << "\"!\n";
+        }
+
+        guard.lock();
+    }
+}
+
+double Metrics::quantile(const vector<uint64_t> &hist, double q) const {
+
+    uint64_t total = 0;
+
+    for (size_t b=0; b<hist.size(); b++) {
+        total += hist[b];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    const uint64_t rank = ceil(q * total);
+    uint64_t count = 0;
+
+    for (size_t b=0; b<hist.size(); b++) {
+        count += hist[b];
+        if (count >= rank) {
+            return bucketValue(b);
+        }
+    }
+
+    return bucketValue(hist.size() - 1);
+}
+
+bool Metrics::write(bool final) {
+
+    const steady_clock::time_point now = steady_clock::now();
+    const double elapsed = duration<double>(now - m_start).count();
+    const double interval = duration<double>(now - m_last).count();
+
+    m_last = now;
+
+    const size_t workers = m_stats.size();
+
+    vector<size_t> queues;
+
+    if (!final) {
+        lock_guard<mutex> guard(m_lock);
+        if (m_queues) {
+            m_queues(queues);
+        }
+    }
+
+    queues.resize(workers, 0);
+
+    vector<uint64_t> evals(workers, 0);
+    vector<double> rates(workers, 0);
+    vector<double> busy(workers, 0);
+    vector<uint64_t> hist(METRICSBUCKETS, 0);
+
+    uint64_t completed = 0;
+    uint64_t hits = 0;
+    uint64_t pending = 0;
+
+    for (size_t w=0; w<workers; w++) {
+
+        WorkerStats &s = *m_stats[w];
+
+        evals[w] = s.evals.load(std::memory_order_relaxed);
+        hits += s.cached.load(std::memory_order_relaxed);
+        completed += evals[w];
+        pending += queues[w];
+
+        rates[w] = (interval > 0) ? (evals[w] - s.lastEvals) / interval : 0;
+        s.lastEvals = evals[w];
+
+        busy[w] = (elapsed > 0) ? s.busy.load(std::memory_order_relaxed) * 1e-9 / elapsed : 0;
+
+        for (size_t b=0; b<METRICSBUCKETS; b++) {
+            hist[b] += s.hist[b].load(std::memory_order_relaxed);
+        }
+    }
+
+    completed += hits;
+
+    const uint64_t bytes =
+        m_bytes.load(std::memory_order_relaxed) + (m_bytesSource ? m_bytesSource() : 0);
+    const double hitRatio = (completed > 0) ? double(hits) / completed : 0;
+    const double p50 = quantile(hist, 0.5);
+    const double p99 = quantile(hist, 0.99);
+
+    ostringstream out;
+
+    if (m_filename.size() >= 5 && m_filename.compare(m_filename.size() - 5, 5, ".json") == 0) {
+
+        out << "{\n"
+            << "  \"program\": \"" << PRGNAME << "\",\n"
+            << "  \"timestamp\": " << time(NULL) << ",\n"
+            << "  \"elapsed_seconds\": " << elapsed << ",\n"
+            << "  \"finished\": " << (final ? "true" : "false") << ",\n"
+            << "  \"jobs_total\": " << m_jobs << ",\n"
+            << "  \"jobs_completed\": " << completed << ",\n"
+            << "  \"jobs_pending\": " << pending << ",\n"
+            << "  \"cache_hits\": " << hits << ",\n"
+            << "  \"cache_hit_ratio\": " << hitRatio << ",\n"
+            << "  \"bytes_written\": " << bytes << ",\n"
+            << "  \"latency_p50_seconds\": " << p50 << ",\n"
+            << "  \"latency_p99_seconds\": " << p99 << ",\n"
+            << "  \"workers\": [\n";
+
+        for (size_t w=0; w<workers; w++) {
+            out << "    { \"worker\": " << w
+                << ", \"evaluations\": " << evals[w]
+                << ", \"evaluations_per_second\": " << rates[w]
+                << ", \"busy_ratio\": " << busy[w]
+                << ", \"queue_depth\": " << queues[w] << " }"
+                << ((w + 1 < workers) ? ",\n" : "\n");
+        }
+
+        out << "  ]\n}\n";
+    }
+    else {
+
+        const string p = string(PRGNAME) + "_";
+
+        out << "# TYPE " << p << "jobs_total gauge\n"
+            << p << "jobs_total " << m_jobs << "\n"
+            << "# TYPE " << p << "jobs_completed gauge\n"
+            << p << "jobs_completed " << completed << "\n"
+            << "# TYPE " << p << "jobs_pending gauge\n"
+            << p << "jobs_pending " << pending << "\n"
+            << "# TYPE " << p << "finished gauge\n"
+            << p << "finished " << (final ? 1 : 0) << "\n"
+            << "# TYPE " << p << "elapsed_seconds gauge\n"
+            << p << "elapsed_seconds " << elapsed << "\n"
+            << "# TYPE " << p << "last_update_timestamp_seconds gauge\n"
+            << p << "last_update_timestamp_seconds " << time(NULL) << "\n"
+            << "# TYPE " << p << "cache_hits_total counter\n"
+            << p << "cache_hits_total " << hits << "\n"
+            << "# TYPE " << p << "cache_hit_ratio gauge\n"
+            << p << "cache_hit_ratio " << hitRatio << "\n"
+            << "# TYPE " << p << "bytes_written_total counter\n"
+            << p << "bytes_written_total " << bytes << "\n"
+            << "# TYPE " << p << "evaluation_latency_seconds summary\n"
+            << p << "evaluation_latency_seconds{quantile=\"0.5\"} " << p50 << "\n"
+            << p << "evaluation_latency_seconds{quantile=\"0.99\"} " << p99 << "\n";
+
+        out << "# TYPE " << p << "worker_evaluations_total counter\n";
+
+        for (size_t w=0; w<workers; w++) {
+            out << p << "worker_evaluations_total{worker=\"" << w << "\"} " << evals[w] << "\n";
+        }
+
+        out << "# TYPE " << p << "worker_evaluations_per_second gauge\n";
+
+        for (size_t w=0; w<workers; w++) {
+            out << p << "worker_evaluations_per_second{worker=\"" << w << "\"} " << rates[w] << "\n";
+        }
+
+        out << "# TYPE " << p << "worker_busy_ratio gauge\n";
+
+        for (size_t w=0; w<workers; w++) {
+            out << p << "worker_busy_ratio{worker=\"" << w << "\"} " << busy[w] << "\n";
+        }
+
+        out << "# TYPE " << p << "worker_queue_depth gauge\n";
+
+        for (size_t w=0; w<workers; w++) {
+            out << p << "worker_queue_depth{worker=\"" << w << "\"} " << queues[w] << "\n";
+        }
+    }
+
+    const string tmpFilename = m_filename + ".tmp";
+
+    ofstream fout(tmpFilename);
+
+    if (!fout) {
+        return false;
+    }
+
+    fout << out.str();
+    fout.close();
+
+    return
+        fout && replaceFile(tmpFilename, m_filename);
+}
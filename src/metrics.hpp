@@ -0,0 +1,95 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: metrics.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <chrono>
+
+#include "const.hpp"
+
+// Progress and throughput of a multi-case run for the node monitoring.
+//
+// The workers only bump their own counters and latency histograms. A
+// thread of its own rewrites the metrics file every METRICSSEC seconds,
+// atomically, so a scraper never reads a half-written file. The format
+// is the Prometheus text one, or JSON if the file name ends with ".json".
+class Metrics {
+
+public:
+
+    Metrics(const std::string &filename, size_t workers, size_t jobs);
+    ~Metrics();
+
+    // sources of the gauges, called by the writer thread; the queues may
+    // be reset to nullptr when their source goes away
+    void setQueues(const std::function<void(std::vector<size_t> &)> &);
+    void setBytes(const std::function<uint64_t()> &);
+
+    void start();
+    void stop(); // writes the final state
+
+    void evaluated(size_t worker, uint64_t ns);
+    void cached(size_t worker); // the job was found done, e.g. in the journal
+    void addBytes(uint64_t);
+
+private:
+
+    struct alignas(64) WorkerStats {
+        std::atomic<uint64_t> evals{0};
+        std::atomic<uint64_t> cached{0};
+        std::atomic<uint64_t> busy{0}; // ns
+        std::atomic<uint64_t> hist[METRICSBUCKETS] = {};
+        uint64_t lastEvals = 0;        // of the writer thread
+    };
+
+    void loop();
+    bool write(bool final);
+    double quantile(const std::vector<uint64_t> &, double) const;
+
+    std::string m_filename;
+    size_t      m_jobs = 0;
+
+    std::vector<std::unique_ptr<WorkerStats>> m_stats;
+    std::atomic<uint64_t> m_bytes{0};
+
+    std::function<void(std::vector<size_t> &)> m_queues;
+    std::function<uint64_t()> m_bytesSource;
+
+    std::thread m_thread;
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_last;
+
+};
+
+#endif // METRICS_HPP
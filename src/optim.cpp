@@ -0,0 +1,572 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: optim.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "optim.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "calc.hpp"
+#include "cycle.hpp"
+#include "sched.hpp"
+#include "store.hpp"
+#include "result.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <random>
+#include <regex>
+#include <limits>
+#include <chrono>
+#include <cmath>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::sort;
+using std::regex;
+using std::regex_match;
+using std::mt19937_64;
+using std::uniform_real_distribution;
+using std::uniform_int_distribution;
+using std::numeric_limits;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace {
+
+typedef uniform_real_distribution<double> Uniform;
+
+// simulated binary crossover of one variable within [lo, hi]
+void crossover(double &x1, double &x2, double lo, double hi, mt19937_64 &rng) {
+
+    Uniform uni(0.0, 1.0);
+
+    if (uni(rng) > 0.5 || fabs(x1 - x2) < 1e-14 || hi <= lo) {
+        return;
+    }
+
+    const double y1 = std::min(x1, x2);
+    const double y2 = std::max(x1, x2);
+    const double u = uni(rng);
+    const double e = 1.0 / (OPTIMETAC + 1.0);
+
+    double beta = 1.0 + 2.0 * (y1 - lo) / (y2 - y1);
+    double alpha = 2.0 - pow(beta, -(OPTIMETAC + 1.0));
+    double betaq = (u <= 1.0 / alpha) ? pow(u * alpha, e) : pow(1.0 / (2.0 - u * alpha), e);
+
+    const double c1 = 0.5 * ((y1 + y2) - betaq * (y2 - y1));
+
+    beta = 1.0 + 2.0 * (hi - y2) / (y2 - y1);
+    alpha = 2.0 - pow(beta, -(OPTIMETAC + 1.0));
+    betaq = (u <= 1.0 / alpha) ? pow(u * alpha, e) : pow(1.0 / (2.0 - u * alpha), e);
+
+    const double c2 = 0.5 * ((y1 + y2) + betaq * (y2 - y1));
+
+    if (uni(rng) <= 0.5) {
+        x1 = std::min(std::max(c2, lo), hi);
+        x2 = std::min(std::max(c1, lo), hi);
+    }
+    else {
+        x1 = std::min(std::max(c1, lo), hi);
+        x2 = std::min(std::max(c2, lo), hi);
+    }
+}
+
+// polynomial mutation of one variable within [lo, hi]
+void mutation(double &x, double lo, double hi, mt19937_64 &rng) {
+
+    if (hi <= lo) {
+        return;
+    }
+
+    Uniform uni(0.0, 1.0);
+
+    const double d1 = (x - lo) / (hi - lo);
+    const double d2 = (hi - x) / (hi - lo);
+    const double u = uni(rng);
+    const double e = 1.0 / (OPTIMETAM + 1.0);
+
+    double dq = 0;
+
+    if (u < 0.5) {
+        const double val = 2.0 * u + (1.0 - 2.0 * u) * pow(1.0 - d1, OPTIMETAM + 1.0);
+        dq = pow(val, e) - 1.0;
+    }
+    else {
+        const double val = 2.0 * (1.0 - u) + 2.0 * (u - 0.5) * pow(1.0 - d2, OPTIMETAM + 1.0);
+        dq = 1.0 - pow(val, e);
+    }
+
+    x = std::min(std::max(x + dq * (hi - lo), lo), hi);
+}
+
+// crowded comparison: the lower rank, then the less crowded
+bool better(const Optim::Member &a, const Optim::Member &b) {
+    return
+        (a.rank != b.rank) ? a.rank < b.rank : a.crowding > b.crowding;
+}
+
+}
+
+Optim::Optim(const shared_ptr<Conf> &conf,
+             const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+bool Optim::readTaskFile(const string &filename) {
+
+    ifstream fin(filename);
+
+    if (!fin) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << filename << "\" to read!\n";
+        return false;
+    }
+
+    string s;
+    string constraints;
+
+    while (!fin.eof()) {
+
+        getline(fin, s);
+
+        if (!s.empty() && s[s.size()-1] == '\r') {
+            s.erase(s.size()-1);
+        }
+
+        if (regex_match(s, regex(COMMENTREGEX)) || s.empty()) {
+            continue;
+        }
+
+        // the constraints have "=" of their own
+        const size_t pos = s.find(PARAMDELIMITER);
+
+        if (pos == string::npos) {
+            continue;
+        }
+
+        const string key = s.substr(0, pos);
+        const string val = s.substr(pos + 1);
+
+        if (key == "min" || key == "max") {
+
+            const size_t col = storeColumnIndex(val);
+
+            if (col == STORECOLUMNS) {
+                cout << ERRORMSGBLANK << "Unknown objective \"" << val
+                     << "\" in file \"" << filename << "\"!\n";
+                return false;
+            }
+
+            m_objs.push_back(col);
+            m_signs.push_back(key == "max" ? -1.0 : 1.0);
+        }
+        else if (key == "constraint") {
+            constraints += (constraints.empty() ? "" : ELEMDELIMITER) + val;
+        }
+        else if (key == "population" || key == "generations" || key == "seed") {
+
+            size_t count = 0;
+
+            if (!stringToCount(val, count)) {
+                cout << ERRORMSGBLANK << "Wrong line \"" << s
+                     << "\" in file \"" << filename << "\"!\n";
+                return false;
+            }
+
+            if (key == "population") {
+                m_population = count;
+            }
+            else if (key == "generations") {
+                m_generations = count;
+            }
+            else {
+                m_seed = count;
+            }
+        }
+        else {
+
+            const size_t idx = Conf::keyIndex(key);
+
+            vector<string> range;
+            splitString(val, range, ELEMDELIMITER);
+
+            // boost is not continuous
+            if (idx == CONFFIELDS || idx == 0 || range.size() != 2 ||
+                !(stringToDouble(range[0]) <= stringToDouble(range[1]))) {
+                cout << ERRORMSGBLANK << "Wrong line \"" << s
+                     << "\" in file \"" << filename << "\"!\n";
+                return false;
+            }
+
+            m_vars.push_back(idx);
+            m_lo.push_back(stringToDouble(range[0]));
+            m_hi.push_back(stringToDouble(range[1]));
+        }
+    }
+
+    fin.close();
+
+    if (m_vars.empty() || m_objs.empty()) {
+        cout << ERRORMSGBLANK << "No inputs or no objectives in file \""
+             << filename << "\"!\n";
+        return false;
+    }
+
+    // the pairs of parents need an even population
+    m_population = std::max<size_t>(4, m_population + m_population % 2);
+
+    return
+        m_constraints.parse(constraints);
+}
+
+bool Optim::run() {
+
+    if (!readTaskFile(m_opts->val_optimfile())) {
+        return false;
+    }
+
+    mt19937_64 rng(m_seed);
+
+    const size_t nv = m_vars.size();
+    const size_t np = m_population;
+
+    cout << MSGBLANK << nv << " inputs, " << m_objs.size() << " objectives, population "
+         << np << ", " << m_generations << " generations.\n";
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    vector<Member> pop(np);
+
+    for (size_t i=0; i<np; i++) {
+
+        pop[i].x.resize(nv);
+
+        for (size_t v=0; v<nv; v++) {
+            pop[i].x[v] = Uniform(m_lo[v], m_hi[v])(rng);
+        }
+    }
+
+    evaluate(pop, 0);
+    rank(pop);
+
+    uniform_int_distribution<size_t> pick(0, np - 1);
+    Uniform uni(0.0, 1.0);
+
+    for (size_t g=0; g<m_generations; g++) {
+
+        // offspring of the binary tournaments
+
+        pop.resize(2 * np);
+
+        for (size_t i=np; i<2*np; i+=2) {
+
+            size_t p[2];
+
+            for (size_t k=0; k<2; k++) {
+                const size_t a = pick(rng);
+                const size_t b = pick(rng);
+                p[k] = better(pop[a], pop[b]) ? a : b;
+            }
+
+            Member &c1 = pop[i];
+            Member &c2 = pop[i+1];
+
+            c1 = Member();
+            c2 = Member();
+            c1.x = pop[p[0]].x;
+            c2.x = pop[p[1]].x;
+
+            if (uni(rng) <= OPTIMCROSS) {
+                for (size_t v=0; v<nv; v++) {
+                    crossover(c1.x[v], c2.x[v], m_lo[v], m_hi[v], rng);
+                }
+            }
+
+            for (size_t v=0; v<nv; v++) {
+                if (uni(rng) < 1.0 / nv) {
+                    mutation(c1.x[v], m_lo[v], m_hi[v], rng);
+                }
+                if (uni(rng) < 1.0 / nv) {
+                    mutation(c2.x[v], m_lo[v], m_hi[v], rng);
+                }
+            }
+        }
+
+        evaluate(pop, np);
+
+        // the parents and the offspring compete for the next generation
+        rank(pop);
+        sort(pop.begin(), pop.end(), better);
+        pop.resize(np);
+    }
+
+    const duration<double> elapsed = steady_clock::now() - start;
+
+    vector<Member> front;
+
+    for (size_t i=0; i<np; i++) {
+        if (pop[i].rank == 0 && pop[i].violation == 0) {
+            front.push_back(pop[i]);
+        }
+    }
+
+    // the copies of a parent surviving along with it
+    sort(front.begin(), front.end(),
+         [](const Member &a, const Member &b) { return a.x < b.x; });
+    front.erase(std::unique(front.begin(), front.end(),
+                            [](const Member &a, const Member &b) { return a.x == b.x; }),
+                front.end());
+
+    cout << MSGBLANK << np * (m_generations + 1) << " cases calculated in "
+         << elapsed.count() << " s, " << front.size() << " on the front.\n";
+
+    if (front.empty()) {
+        cout << WARNMSGBLANK << "No feasible cases found.\n";
+    }
+
+    sort(front.begin(), front.end(),
+         [](const Member &a, const Member &b) { return a.obj[0] < b.obj[0]; });
+
+    return
+        createReport(front);
+}
+
+void Optim::evaluate(vector<Member> &pop, size_t from) const {
+
+    const Conf &base = *m_conf;
+
+    Sched sched(m_opts->val_threads(), m_opts->val_pin());
+    vector<unique_ptr<Conf>> confs(sched.workers());
+
+    sched.run(
+        pop.size() - from,
+        [&](size_t job) {
+            Conf conf(base);
+            for (size_t v=0; v<m_vars.size(); v++) {
+                conf.setValue(m_vars[v], pop[from + job].x[v]);
+            }
+            conf.evaluate();
+            return Calc::cost(conf);
+        },
+        [&](size_t w) {
+            confs[w].reset(new Conf(base));
+        },
+        [&](size_t w, size_t job) {
+
+            Member &m = pop[from + job];
+            Conf &conf = *confs[w];
+
+            conf = base;
+
+            for (size_t v=0; v<m_vars.size(); v++) {
+                conf.setValue(m_vars[v], m.x[v]);
+            }
+
+            conf.evaluate();
+
+            conf.values(m.cols);
+
+            double *out = m.cols + CONFFIELDS;
+
+            if (cycleValidAngles(conf.val_teta(), conf.val_phiz(), conf.val_da())) {
+                cycleStream(conf, nullptr, nullptr, nullptr, out);
+            }
+            else {
+                std::fill(out, out + CALCOUTPUTS, numeric_limits<double>::quiet_NaN());
+            }
+
+            m.obj.resize(m_objs.size());
+            m.violation = m_constraints.violation(m.cols);
+
+            // a case without a finite objective is never feasible, so the
+            // objectives compared and crowded are finite
+
+            for (size_t k=0; k<m_objs.size(); k++) {
+
+                m.obj[k] = m_signs[k] * m.cols[m_objs[k]];
+
+                if (!std::isfinite(m.obj[k])) {
+                    m.violation = numeric_limits<double>::infinity();
+                }
+            }
+        }
+        );
+}
+
+// constrained domination
+bool Optim::dominates(const Member &a, const Member &b) const {
+
+    if (a.violation != b.violation) {
+        return a.violation < b.violation;
+    }
+
+    if (a.violation > 0) {
+        return false;
+    }
+
+    bool strictly = false;
+
+    for (size_t k=0; k<a.obj.size(); k++) {
+        if (a.obj[k] > b.obj[k]) {
+            return false;
+        }
+        if (a.obj[k] < b.obj[k]) {
+            strictly = true;
+        }
+    }
+
+    return strictly;
+}
+
+// fast nondominated sort and the crowding distances within the fronts
+void Optim::rank(vector<Member> &pop) const {
+
+    const size_t n = pop.size();
+
+    vector<vector<size_t>> dominated(n);
+    vector<size_t> count(n, 0);
+    vector<size_t> front;
+
+    for (size_t i=0; i<n; i++) {
+
+        for (size_t j=i+1; j<n; j++) {
+            if (dominates(pop[i], pop[j])) {
+                dominated[i].push_back(j);
+                count[j]++;
+            }
+            else if (dominates(pop[j], pop[i])) {
+                dominated[j].push_back(i);
+                count[i]++;
+            }
+        }
+    }
+
+    for (size_t i=0; i<n; i++) {
+        if (count[i] == 0) {
+            front.push_back(i);
+        }
+    }
+
+    for (size_t r=0; !front.empty(); r++) {
+
+        vector<size_t> next;
+
+        for (size_t i=0; i<front.size(); i++) {
+
+            pop[front[i]].rank = r;
+            pop[front[i]].crowding = 0;
+
+            for (size_t j=0; j<dominated[front[i]].size(); j++) {
+                if (--count[dominated[front[i]][j]] == 0) {
+                    next.push_back(dominated[front[i]][j]);
+                }
+            }
+        }
+
+        // the members without the finite objectives stay uncrowded, their
+        // NaNs would break the ordering of the sorts
+
+        vector<size_t> crowded;
+
+        for (size_t i=0; i<front.size(); i++) {
+            if (std::isfinite(pop[front[i]].violation)) {
+                crowded.push_back(front[i]);
+            }
+        }
+
+        for (size_t k=0; k<m_objs.size() && !crowded.empty(); k++) {
+
+            sort(crowded.begin(), crowded.end(),
+                 [&](size_t a, size_t b) { return pop[a].obj[k] < pop[b].obj[k]; });
+
+            const double lo = pop[crowded[0]].obj[k];
+            const double hi = pop[crowded[crowded.size()-1]].obj[k];
+
+            pop[crowded[0]].crowding = numeric_limits<double>::infinity();
+            pop[crowded[crowded.size()-1]].crowding = numeric_limits<double>::infinity();
+
+            if (!(hi > lo)) {
+                continue;
+            }
+
+            for (size_t i=1; i+1<crowded.size(); i++) {
+                pop[crowded[i]].crowding +=
+                    (pop[crowded[i+1]].obj[k] - pop[crowded[i-1]].obj[k]) / (hi - lo);
+            }
+        }
+
+        front.swap(next);
+    }
+}
+
+bool Optim::createReport(const vector<Member> &front) const {
+
+    string reportFilename = m_opts->val_output();
+
+    if (reportFilename.empty()) {
+        reportFilename = string(PRGNAME) + "_pareto_" + currDateTime() + ".csv";
+    }
+
+    const string tmpFilename = reportFilename + ".tmp";
+
+    ofstream fout(tmpFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    writeResultHeader(fout);
+
+    for (size_t i=0; i<front.size(); i++) {
+
+        Result res;
+
+        res.index = i;
+        std::copy(front[i].cols, front[i].cols + CONFFIELDS, res.in);
+        std::copy(front[i].cols + CONFFIELDS, front[i].cols + STORECOLUMNS, res.out);
+
+        writeResult(fout, res);
+    }
+
+    fout.close();
+
+    if (!fout || !replaceFile(tmpFilename, reportFilename)) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << reportFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\" created.\n\n";
+
+    return true;
+}
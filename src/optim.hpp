@@ -0,0 +1,97 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: optim.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPTIM_HPP
+#define OPTIM_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "conf.hpp"
+#include "opts.hpp"
+#include "filter.hpp"
+#include "store.hpp"
+
+// Multi-objective optimizer (NSGA-II) over the inputs of the configuration.
+//
+// The file of the task lists the varied inputs with their limits, the
+// objectives and the constraints:
+//
+//   teta=6,20
+//   alpha=1.3,2.0
+//   max=Ne
+//   min=ge
+//   constraint=P_fire_max<=16000
+//   constraint=etae>=0.42
+//   population=100
+//   generations=50
+//   seed=1
+//
+// Every generation is evaluated in parallel. The infeasible cases lose to
+// the feasible ones and to each other by the size of the violation. The
+// result is the front of the nondominated feasible cases with all of
+// their inputs and outputs.
+class Optim {
+
+public:
+
+    Optim(const std::shared_ptr<Conf> &conf,
+          const std::shared_ptr<Opts> &opts);
+
+    bool run();
+
+    struct Member {
+        std::vector<double> x;
+        std::vector<double> obj; // all minimized
+        double cols[STORECOLUMNS] = {};
+        double violation = 0;
+        size_t rank      = 0;
+        double crowding  = 0;
+    };
+
+private:
+
+    bool readTaskFile(const std::string &);
+    void evaluate(std::vector<Member> &, size_t from) const;
+    bool dominates(const Member &, const Member &) const;
+    void rank(std::vector<Member> &) const;
+    bool createReport(const std::vector<Member> &) const;
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+
+    std::vector<size_t> m_vars;
+    std::vector<double> m_lo;
+    std::vector<double> m_hi;
+
+    std::vector<size_t> m_objs;
+    std::vector<double> m_signs; // -1 for the maximized objectives
+
+    Filter m_constraints;
+
+    size_t   m_population  = 100;
+    size_t   m_generations = 50;
+    uint64_t m_seed        = 1;
+
+};
+
+#endif // OPTIM_HPP
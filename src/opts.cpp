@@ -0,0 +1,311 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: opts.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "opts.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::string;
+using std::vector;
+
+namespace {
+
+bool nextArg(int argc, char **argv, int &i, string &val) {
+
+    if (i + 1 >= argc) {
+        cout << ERRORMSGBLANK << "Option \"" << argv[i] << "\" needs a value!\n";
+        return false;
+    }
+
+    val = argv[++i];
+
+    return true;
+}
+
+bool optionalArg(int argc, char **argv, int &i, string &val) {
+
+    if (i + 1 >= argc || argv[i+1][0] == '-') {
+        return false;
+    }
+
+    val = argv[++i];
+
+    return true;
+}
+
+}
+
+bool Opts::readCommandLine(int argc, char **argv) {
+
+    m_sweepfile = SWEEPFILE;
+    m_storefile = STOREFILE;
+    m_optimfile = OPTIMFILE;
+    m_refinefile = REFINEFILE;
+    m_metricsfile = METRICSFILE;
+    m_analyzefile = DAQFILE;
+    m_doefile = DOEFILE;
+    m_wcetcalls = WCETCALLS;
+
+    string val;
+
+    for (int i=1; i<argc; i++) {
+
+        const string arg(argv[i]);
+
+        if (arg == "--help" || arg == "-h") {
+            m_help = true;
+            printUsage();
+        }
+        else if (arg == "--sweep") {
+            m_sweep = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_sweepfile = val;
+            }
+        }
+        else if (arg == "--table") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_sweep = true;
+            m_tablefile = val;
+        }
+        else if (arg == "--doe") {
+            m_sweep = true;
+            m_doe = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_doefile = val;
+            }
+        }
+        else if (arg == "--shard") {
+
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+
+            vector<string> elem;
+            splitString(val, elem, "/");
+
+            if (elem.size() != 2 ||
+                !stringToCount(elem[0], m_shard) || !stringToCount(elem[1], m_shards) ||
+                m_shards == 0 ||
+                m_shard == 0 || m_shard > m_shards) {
+                cout << ERRORMSGBLANK << "Wrong shard \"" << val
+                     << "\", \"k/N\" with k = 1..N expected!\n";
+                return false;
+            }
+        }
+        else if (arg == "--merge") {
+            m_merge = true;
+            while (optionalArg(argc, argv, i, val)) {
+                m_mergefiles.push_back(val);
+            }
+        }
+        else if (arg == "--store") {
+            m_store = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_storefile = val;
+            }
+        }
+        else if (arg == "--query") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_query = true;
+            m_filter = val;
+        }
+        else if (arg == "--solve") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_solvespec = val;
+        }
+        else if (arg == "--bracket") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_bracket = val;
+        }
+        else if (arg == "--optimize") {
+            m_optim = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_optimfile = val;
+            }
+        }
+        else if (arg == "--build-map") {
+            m_buildmap = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_sweepfile = val;
+            }
+        }
+        else if (arg == "--map") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_map = true;
+            m_mapfile = val;
+        }
+        else if (arg == "--aggregate") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_aggregates.push_back(val);
+        }
+        else if (arg == "--where") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_where = val;
+        }
+        else if (arg == "--refine") {
+            m_refine = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_refinefile = val;
+            }
+        }
+        else if (arg == "--analyze") {
+            m_analyze = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_analyzefile = val;
+            }
+        }
+        else if (arg == "--closed") {
+            m_closed = true;
+        }
+        else if (arg == "--parareal") {
+            m_parareal = true;
+        }
+        else if (arg == "--wcet") {
+            m_wcet = true;
+            if (optionalArg(argc, argv, i, val) && !stringToCount(val, m_wcetcalls)) {
+                cout << ERRORMSGBLANK << "Wrong number of calls \""
+                     << val << "\"!\n";
+                return false;
+            }
+        }
+        else if (arg == "--core") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            if (!stringToCount(val, m_core)) {
+                cout << ERRORMSGBLANK << "Wrong core \""
+                     << val << "\"!\n";
+                return false;
+            }
+            m_pincore = true;
+        }
+        else if (arg == "--mlock") {
+            m_mlock = true;
+        }
+        else if (arg == "--watch") {
+            m_watch = true;
+        }
+        else if (arg == "--metrics") {
+            m_metrics = true;
+            if (optionalArg(argc, argv, i, val)) {
+                m_metricsfile = val;
+            }
+        }
+        else if (arg == "--output" || arg == "-o") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            m_output = val;
+        }
+        else if (arg == "--journal") {
+            m_journal = true;
+        }
+        else if (arg == "--threads") {
+            if (!nextArg(argc, argv, i, val)) {
+                return false;
+            }
+            if (!stringToCount(val, m_threads)) {
+                cout << ERRORMSGBLANK << "Wrong number of threads \""
+                     << val << "\"!\n";
+                return false;
+            }
+        }
+        else if (arg == "--no-pin") {
+            m_pin = false;
+        }
+        else {
+            cout << ERRORMSGBLANK << "Unknown option \"" << arg << "\"!\n\n";
+            printUsage();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Opts::printUsage() const {
+
+    cout << "Usage: " << PRGNAME << " [options]\n\n"
+         << "Without options the single case from \"" << CONFIGFILE << "\" is calculated.\n\n"
+         << "  --sweep [file]     calculate all cases of the sweep file (default \"" << SWEEPFILE << "\")\n"
+         << "  --table file       calculate all cases of the table (header of keys, \"" << CSVDELIMITER << "\" delimited)\n"
+         << "  --doe [file]       calculate the cases of the design of experiments of the\n"
+         << "                     file (Sobol, Halton or LHS; default \"" << DOEFILE << "\")\n"
+         << "  --shard k/N        calculate only the k-th of N shards of the cases\n"
+         << "                     and write the partial result file\n"
+         << "  --merge files...   merge the partial result files of all shards\n"
+         << "  --store [file]     add the results of the run to the summary store\n"
+         << "                     (default \"" << STOREFILE << "\")\n"
+         << "  --query filter     select the stored cases, e.g. \"ge<210,P_fire_max<16000\";\n"
+         << "                     the store is given by --store\n"
+         << "  --solve in:out=t   find the input which gives the target of the output\n"
+         << "                     for every case, e.g. \"pk:Ne=150\" or \"teta:P_fire_max=14000,16000,500\"\n"
+         << "  --bracket lo,hi    limits of the input to solve for\n"
+         << "  --optimize [file]  find the Pareto front of the task file (default \"" << OPTIMFILE << "\")\n"
+         << "  --refine [file]    adaptive sampling of the grid of the task file around the\n"
+         << "                     thresholds and changes of the outputs (default \"" << REFINEFILE << "\")\n"
+         << "  --build-map [file] calculate the engine map over the grid of the sweep file\n"
+         << "                     and write it to \"" << MAPFILE << "\" or the --output file\n"
+         << "  --map file         answer the cases of --table from the engine map\n"
+         << "  --aggregate spec   reduce the cases of the sweep instead of reporting all of\n"
+         << "                     them: \"min:col[:K[:key]]\", \"max:col[:K[:key]]\",\n"
+         << "                     \"hist:col:bins:lo,hi\" or \"stats:col[:key]\"; may be repeated\n"
+         << "  --where filter     aggregate only the cases of the filter, e.g. \"P_fire_max<16000\"\n"
+         << "  --analyze [file]   heat release analysis of the measured pressure of the DAQ\n"
+         << "                     file described by the file (default \"" << DAQFILE << "\")\n"
+         << "  --closed           close the cycle: tr follows from the end of the expansion\n"
+         << "                     (single case and --sweep/--table)\n"
+         << "  --parareal         parallel-in-time fire phase of the single case for the\n"
+         << "                     fine resolutions\n"
+         << "  --wcet [calls]     execution times of the real-time mode over the random\n"
+         << "                     inputs around the configuration (default " << WCETCALLS << " calls)\n"
+         << "  --core N           pin the --wcet calls to the N-th core\n"
+         << "  --mlock            lock the memory of the --wcet calls\n"
+         << "  --watch            calculate the single case again on every save of\n"
+         << "                     \"" << CONFIGFILE << "\" and rewrite \"" << WATCHFILE << "\" or the --output file\n"
+         << "  --metrics [file]   keep the progress of the sweep in the metrics file\n"
+         << "                     (default \"" << METRICSFILE << "\", JSON if named *.json)\n"
+         << "  --output file      name of the result file\n"
+         << "  --journal          journal the calculated cases and resume from the\n"
+         << "                     journal if the run was interrupted\n"
+         << "  --threads N        number of worker threads (default: all cores)\n"
+         << "  --no-pin           do not pin worker threads to cores\n"
+         << "  --help             show this help\n\n";
+}
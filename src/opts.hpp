@@ -0,0 +1,152 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: opts.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPTS_HPP
+#define OPTS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class Opts {
+
+public:
+
+    bool readCommandLine(int, char **);
+
+    bool        val_help()      const { return m_help;      }
+
+    bool        val_sweep()     const { return m_sweep;     }
+    std::string val_sweepfile() const { return m_sweepfile; }
+    std::string val_tablefile() const { return m_tablefile; }
+    bool        val_doe()       const { return m_doe;       }
+    std::string val_doefile()   const { return m_doefile;   }
+    size_t      val_threads()   const { return m_threads;   }
+    bool        val_pin()       const { return m_pin;       }
+    std::string val_output()    const { return m_output;    }
+    bool        val_journal()   const { return m_journal;   }
+
+    // shard k of N, k = 1..N; N = 1 for the whole run
+    size_t      val_shard()     const { return m_shard;     }
+    size_t      val_shards()    const { return m_shards;    }
+
+    bool        val_merge()     const { return m_merge;     }
+    const std::vector<std::string> &val_mergefiles() const { return m_mergefiles; }
+
+    bool        val_store()     const { return m_store;     }
+    std::string val_storefile() const { return m_storefile; }
+    bool        val_query()     const { return m_query;     }
+    std::string val_filter()    const { return m_filter;    }
+
+    bool        val_solve()     const { return !m_solvespec.empty(); }
+    std::string val_solvespec() const { return m_solvespec; }
+    std::string val_bracket()   const { return m_bracket;   }
+
+    bool        val_optim()     const { return m_optim;     }
+    std::string val_optimfile() const { return m_optimfile; }
+
+    bool        val_refine()     const { return m_refine;     }
+    std::string val_refinefile() const { return m_refinefile; }
+
+    bool        val_buildmap()  const { return m_buildmap;  }
+    bool        val_map()       const { return m_map;       }
+    std::string val_mapfile()   const { return m_mapfile;   }
+
+    const std::vector<std::string> &val_aggregates() const { return m_aggregates; }
+    std::string val_where()       const { return m_where;       }
+
+    bool        val_analyze()     const { return m_analyze;     }
+    std::string val_analyzefile() const { return m_analyzefile; }
+
+    bool        val_closed()      const { return m_closed;      }
+    bool        val_parareal()    const { return m_parareal;    }
+
+    bool        val_wcet()        const { return m_wcet;        }
+    size_t      val_wcetcalls()   const { return m_wcetcalls;   }
+    bool        val_pincore()     const { return m_pincore;     }
+    size_t      val_core()        const { return m_core;        }
+    bool        val_mlock()       const { return m_mlock;       }
+    bool        val_watch()       const { return m_watch;       }
+
+    bool        val_metrics()     const { return m_metrics;     }
+    std::string val_metricsfile() const { return m_metricsfile; }
+
+private:
+
+    void printUsage() const;
+
+    bool        m_help      = false;
+
+    bool        m_sweep     = false;
+    std::string m_sweepfile;
+    std::string m_tablefile;
+    bool        m_doe       = false;
+    std::string m_doefile;
+    size_t      m_threads   = 0;
+    bool        m_pin       = true;
+    std::string m_output;
+    bool        m_journal   = false;
+
+    size_t      m_shard     = 1;
+    size_t      m_shards    = 1;
+
+    bool        m_merge     = false;
+    std::vector<std::string> m_mergefiles;
+
+    bool        m_store     = false;
+    std::string m_storefile;
+    bool        m_query     = false;
+    std::string m_filter;
+
+    std::string m_solvespec;
+    std::string m_bracket;
+
+    bool        m_optim     = false;
+    std::string m_optimfile;
+
+    bool        m_refine    = false;
+    std::string m_refinefile;
+
+    bool        m_buildmap  = false;
+    bool        m_map       = false;
+    std::string m_mapfile;
+
+    std::vector<std::string> m_aggregates;
+    std::string m_where;
+
+    bool        m_analyze   = false;
+    std::string m_analyzefile;
+
+    bool        m_closed    = false;
+    bool        m_parareal  = false;
+
+    bool        m_wcet      = false;
+    size_t      m_wcetcalls = 0;
+    bool        m_pincore   = false;
+    size_t      m_core      = 0;
+    bool        m_mlock     = false;
+    bool        m_watch     = false;
+
+    bool        m_metrics   = false;
+    std::string m_metricsfile;
+
+};
+
+#endif // OPTS_HPP
@@ -0,0 +1,494 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: refine.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "refine.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "cycle.hpp"
+#include "sched.hpp"
+#include "result.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <regex>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::map;
+using std::set;
+using std::ifstream;
+using std::ofstream;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::regex;
+using std::regex_match;
+using std::sort;
+using std::numeric_limits;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace {
+
+// the crossing cells first, then by the change, then by the position
+bool priority(const Refine::Cell &a, const Refine::Cell &b) {
+
+    if (a.crossing != b.crossing) {
+        return a.crossing;
+    }
+
+    if (a.change != b.change) {
+        return a.change > b.change;
+    }
+
+    return a.lo < b.lo;
+}
+
+}
+
+Refine::Refine(const shared_ptr<Conf> &conf,
+               const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+bool Refine::readTaskFile(const string &filename) {
+
+    ifstream fin(filename);
+
+    if (!fin) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << filename << "\" to read!\n";
+        return false;
+    }
+
+    string s;
+
+    while (!fin.eof()) {
+
+        getline(fin, s);
+
+        if (!s.empty() && s[s.size()-1] == '\r') {
+            s.erase(s.size()-1);
+        }
+
+        if (regex_match(s, regex(COMMENTREGEX)) || s.empty()) {
+            continue;
+        }
+
+        const size_t pos = s.find(PARAMDELIMITER);
+
+        if (pos == string::npos) {
+            continue;
+        }
+
+        const string key = s.substr(0, pos);
+        const string val = s.substr(pos + 1);
+
+        vector<string> elem;
+        splitString(val, elem, ELEMDELIMITER);
+
+        bool ok = true;
+
+        if (key == "output") {
+            m_outputs.push_back(outputIndex(val));
+            ok = m_outputs.back() != CALCOUTPUTS;
+        }
+        else if (key == "threshold") {
+            ok = elem.size() == 2 && outputIndex(elem[0]) != CALCOUTPUTS;
+            if (ok) {
+                m_thresholdOutputs.push_back(outputIndex(elem[0]));
+                m_thresholds.push_back(stringToDouble(elem[1]));
+            }
+        }
+        else if (key == "tolerance") {
+            m_tolerance = stringToDouble(val);
+            ok = m_tolerance > 0;
+        }
+        else if (key == "budget") {
+            ok = stringToCount(val, m_budget);
+        }
+        else if (key == "levels") {
+            ok = stringToCount(val, m_levels) && m_levels < 31;
+        }
+        else {
+
+            const size_t idx = Conf::keyIndex(key);
+            size_t points = 0;
+
+            // boost is not continuous
+            ok = idx != CONFFIELDS && idx != 0 && elem.size() == 3 &&
+                 stringToDouble(elem[0]) < stringToDouble(elem[1]) &&
+                 stringToCount(elem[2], points) && points >= 2;
+
+            if (ok) {
+                m_keys.push_back(idx);
+                m_from.push_back(stringToDouble(elem[0]));
+                m_to.push_back(stringToDouble(elem[1]));
+                m_points.push_back(points);
+            }
+        }
+
+        if (!ok) {
+            cout << ERRORMSGBLANK << "Wrong line \"" << s
+                 << "\" in file \"" << filename << "\"!\n";
+            return false;
+        }
+    }
+
+    fin.close();
+
+    if (m_keys.empty() || m_keys.size() > REFINEMAXAXES ||
+        (m_outputs.empty() && m_thresholds.empty())) {
+        cout << ERRORMSGBLANK << "1 to " << REFINEMAXAXES
+             << " axes and some outputs or thresholds are expected in file \""
+             << filename << "\"!\n";
+        return false;
+    }
+
+    // the finest lattice must fit the coordinates
+    for (size_t a=0; a<m_keys.size(); a++) {
+        if ((m_points[a] - 1) * (uint64_t(1) << m_levels) > 0xffffffffULL) {
+            cout << ERRORMSGBLANK << "Too many points or levels in file \""
+                 << filename << "\"!\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Refine::evaluate(vector<Point> &points, size_t from) const {
+
+    const Conf &base = *m_conf;
+
+    Sched sched(m_opts->val_threads(), m_opts->val_pin());
+    vector<unique_ptr<Conf>> confs(sched.workers());
+
+    sched.run(
+        points.size() - from,
+        [&](size_t) {
+            return 1.0;
+        },
+        [&](size_t w) {
+            confs[w].reset(new Conf(base));
+        },
+        [&](size_t w, size_t job) {
+
+            Point &p = points[from + job];
+            Conf &conf = *confs[w];
+
+            conf = base;
+
+            for (size_t a=0; a<m_keys.size(); a++) {
+                conf.setValue(m_keys[a], m_from[a] + (m_to[a] - m_from[a]) *
+                              p.u[a] / (double(m_points[a] - 1) * m_scale));
+            }
+
+            conf.evaluate();
+            conf.values(p.in);
+
+            if (cycleValidAngles(conf.val_teta(), conf.val_phiz(), conf.val_da())) {
+                cycleStream(conf, nullptr, nullptr, nullptr, p.out);
+            }
+            else {
+                std::fill(p.out, p.out + CALCOUTPUTS, numeric_limits<double>::quiet_NaN());
+            }
+        }
+        );
+}
+
+void Refine::score(Cell &cell, const vector<Point> &points) const {
+
+    const size_t dims = m_keys.size();
+
+    double lo[CALCOUTPUTS];
+    double hi[CALCOUTPUTS];
+    bool nan[CALCOUTPUTS];
+
+    for (size_t o=0; o<CALCOUTPUTS; o++) {
+        lo[o] = numeric_limits<double>::infinity();
+        hi[o] = -numeric_limits<double>::infinity();
+        nan[o] = false;
+    }
+
+    vector<uint32_t> u(dims);
+
+    for (size_t corner=0; corner<(size_t(1) << dims); corner++) {
+
+        for (size_t a=0; a<dims; a++) {
+            u[a] = cell.lo[a] + (((corner >> a) & 1) ? cell.size : 0);
+        }
+
+        const Point &p = points[m_index.at(u)];
+
+        for (size_t o=0; o<CALCOUTPUTS; o++) {
+            nan[o] = nan[o] || std::isnan(p.out[o]);
+            lo[o] = std::min(lo[o], p.out[o]);
+            hi[o] = std::max(hi[o], p.out[o]);
+        }
+    }
+
+    // the cells with NaN corners are outside of the model, not interesting
+
+    cell.crossing = false;
+    cell.change = 0;
+
+    for (size_t t=0; t<m_thresholds.size(); t++) {
+
+        const size_t o = m_thresholdOutputs[t];
+
+        if (!nan[o] && lo[o] < m_thresholds[t] && m_thresholds[t] <= hi[o]) {
+            cell.crossing = true;
+        }
+    }
+
+    for (size_t i=0; i<m_outputs.size(); i++) {
+
+        const size_t o = m_outputs[i];
+        const double scale = std::max(fabs(lo[o]), fabs(hi[o]));
+
+        if (!nan[o] && scale > 0) {
+            cell.change = std::max(cell.change, (hi[o] - lo[o]) / scale / m_tolerance);
+        }
+    }
+}
+
+bool Refine::run() {
+
+    if (!readTaskFile(m_opts->val_refinefile())) {
+        return false;
+    }
+
+    const size_t dims = m_keys.size();
+
+    m_scale = uint32_t(1) << m_levels;
+    m_index.clear();
+
+    vector<Point> points;
+    vector<Cell> cells;
+
+    // the coarse grid
+
+    size_t coarse = 1;
+
+    for (size_t a=0; a<dims; a++) {
+        coarse *= m_points[a];
+    }
+
+    for (size_t i=0; i<coarse; i++) {
+
+        Point p;
+        p.u.resize(dims);
+
+        for (size_t a=0, idx=i; a<dims; a++) {
+            p.u[a] = (idx % m_points[a]) * m_scale;
+            idx /= m_points[a];
+        }
+
+        m_index[p.u] = points.size();
+        points.push_back(p);
+
+        bool inner = true;
+
+        for (size_t a=0; a<dims; a++) {
+            inner = inner && p.u[a] < (m_points[a] - 1) * m_scale;
+        }
+
+        if (inner) {
+            Cell c;
+            c.lo = p.u;
+            c.size = m_scale;
+            cells.push_back(c);
+        }
+    }
+
+    cout << MSGBLANK << dims << " axes, " << coarse << " coarse points, budget "
+         << m_budget << ", " << m_levels << " levels.\n";
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    evaluate(points, 0);
+
+    size_t maxLevel = 0;
+
+    for (size_t round=1; ; round++) {
+
+        for (size_t c=0; c<cells.size(); c++) {
+            score(cells[c], points);
+        }
+
+        sort(cells.begin(), cells.end(), priority);
+
+        // the cells to split and their new points, within the budget
+
+        const size_t before = points.size();
+        vector<Cell> next;
+        size_t split = 0;
+        size_t c = 0;
+
+        for (; c<cells.size(); c++) {
+
+            const Cell &cell = cells[c];
+
+            if (cell.level >= m_levels || !(cell.crossing || cell.change > 1.0)) {
+                break;
+            }
+
+            // the 3^dims points of the halves, the new ones
+            const uint32_t half = cell.size / 2;
+            vector<vector<uint32_t>> added;
+            size_t combos = 1;
+
+            for (size_t a=0; a<dims; a++) {
+                combos *= 3;
+            }
+
+            vector<uint32_t> u(dims);
+
+            for (size_t k=0; k<combos; k++) {
+
+                for (size_t a=0, idx=k; a<dims; a++) {
+                    u[a] = cell.lo[a] + (idx % 3) * half;
+                    idx /= 3;
+                }
+
+                if (m_index.find(u) == m_index.end()) {
+                    added.push_back(u);
+                    m_index[u] = points.size() + added.size() - 1;
+                }
+            }
+
+            if (points.size() + added.size() > m_budget) {
+                for (size_t i=0; i<added.size(); i++) {
+                    m_index.erase(added[i]);
+                }
+                break;
+            }
+
+            for (size_t i=0; i<added.size(); i++) {
+                Point p;
+                p.u = added[i];
+                p.level = cell.level + 1;
+                points.push_back(p);
+            }
+
+            for (size_t k=0; k<(size_t(1) << dims); k++) {
+
+                Cell child;
+                child.lo = cell.lo;
+                child.size = half;
+                child.level = cell.level + 1;
+
+                for (size_t a=0; a<dims; a++) {
+                    child.lo[a] += ((k >> a) & 1) ? half : 0;
+                }
+
+                next.push_back(child);
+            }
+
+            maxLevel = std::max(maxLevel, cell.level + 1);
+            split++;
+        }
+
+        if (split == 0) {
+            break;
+        }
+
+        next.insert(next.end(), cells.begin() + c, cells.end());
+        cells.swap(next);
+
+        evaluate(points, before);
+
+        cout << MSGBLANK << "Round " << round << ": " << split << " cells split, "
+             << points.size() - before << " points.\n";
+    }
+
+    const duration<double> elapsed = steady_clock::now() - start;
+
+    // the dense grid of the same resolution for the comparison
+    double dense = 1;
+
+    for (size_t a=0; a<dims; a++) {
+        dense *= (m_points[a] - 1) * double(uint64_t(1) << maxLevel) + 1;
+    }
+
+    cout << MSGBLANK << points.size() << " points calculated in " << elapsed.count()
+         << " s, " << cells.size() << " cells; the dense grid of level " << maxLevel
+         << " has " << dense << " points.\n";
+
+    return
+        createReport(points);
+}
+
+bool Refine::createReport(const vector<Point> &points) const {
+
+    string reportFilename = m_opts->val_output();
+
+    if (reportFilename.empty()) {
+        reportFilename = string(PRGNAME) + "_refine_" + currDateTime() + ".csv";
+    }
+
+    ofstream fout(reportFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << reportFilename << "\" to write!\n";
+        return false;
+    }
+
+    fout << "level" << CSVDELIMITER;
+    writeResultHeader(fout);
+
+    for (size_t i=0; i<points.size(); i++) {
+
+        Result res;
+
+        res.index = i;
+        std::copy(points[i].in, points[i].in + CONFFIELDS, res.in);
+        std::copy(points[i].out, points[i].out + CALCOUTPUTS, res.out);
+
+        fout << points[i].level << CSVDELIMITER;
+        writeResult(fout, res);
+    }
+
+    fout.close();
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << reportFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\" created.\n\n";
+
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: refine.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REFINE_HPP
+#define REFINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "const.hpp"
+#include "conf.hpp"
+#include "opts.hpp"
+
+// Adaptive sampling of the operating space. The file of the task gives
+// the coarse grid, the watched outputs and the limits:
+//
+//   n=1200,2200,6
+//   pk=150,250,5
+//   output=ge
+//   threshold=P_fire_max,16000
+//   tolerance=0.02
+//   budget=5000
+//   levels=6
+//
+// "key=from,to,points" are the axes (up to REFINEMAXAXES). A cell of the
+// grid is split in halves along every axis when a threshold lies between
+// the values at its corners or an output changes across it by more than
+// tolerance (relative); the cells crossing a threshold go first, then the
+// ones of the largest change. Every round refines as many cells as the
+// budget of the calculations allows and calculates their new points in
+// parallel; the cells are split at most levels times. The result is every
+// calculated point with the level of the refinement which added it.
+class Refine {
+
+public:
+
+    Refine(const std::shared_ptr<Conf> &conf,
+           const std::shared_ptr<Opts> &opts);
+
+    bool run();
+
+    struct Point {
+        std::vector<uint32_t> u; // on the lattice of the finest level
+        size_t level = 0;
+        double in[CONFFIELDS]   = {};
+        double out[CALCOUTPUTS] = {};
+    };
+
+    struct Cell {
+        std::vector<uint32_t> lo;
+        uint32_t size  = 0;
+        size_t   level = 0;
+        bool     crossing = false;
+        double   change   = 0;
+    };
+
+private:
+
+    bool readTaskFile(const std::string &);
+    void evaluate(std::vector<Point> &, size_t from) const;
+    void score(Cell &, const std::vector<Point> &) const;
+    bool createReport(const std::vector<Point> &) const;
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+
+    std::vector<size_t> m_keys;
+    std::vector<double> m_from;
+    std::vector<double> m_to;
+    std::vector<size_t> m_points;
+
+    std::vector<size_t> m_outputs;
+    std::vector<size_t> m_thresholdOutputs;
+    std::vector<double> m_thresholds;
+
+    double m_tolerance = 0.02;
+    size_t m_budget    = 1000;
+    size_t m_levels    = 6;
+
+    uint32_t m_scale = 1; // lattice units per coarse step
+
+    // the points by their lattice coordinates
+    std::map<std::vector<uint32_t>, size_t> m_index;
+
+};
+
+#endif // REFINE_HPP
@@ -0,0 +1,87 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: result.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "result.hpp"
+#include "const.hpp"
+#include "conf.hpp"
+
+#include <string>
+#include <ostream>
+#include <iomanip>
+
+using std::string;
+using std::ostream;
+using std::setprecision;
+using std::defaultfloat;
+
+namespace {
+
+// units: kPa, -, g/kWh, g/kWh, kW, kPa, kPa
+const char *const outputNames[CALCOUTPUTS] = {
+    "pe", "etae", "gi", "ge", "Ne", "P_comp_max", "P_fire_max"
+};
+
+}
+
+const char *outputName(size_t idx) {
+    return
+        (idx < CALCOUTPUTS) ? outputNames[idx] : "";
+}
+
+size_t outputIndex(const string &name) {
+
+    for (size_t i=0; i<CALCOUTPUTS; i++) {
+        if (name == outputNames[i]) {
+            return i;
+        }
+    }
+
+    return CALCOUTPUTS;
+}
+
+void writeResultHeader(ostream &out) {
+
+    out << "index";
+
+    for (size_t i=0; i<CONFFIELDS; i++) {
+        out << CSVDELIMITER << Conf::key(i);
+    }
+
+    for (size_t i=0; i<CALCOUTPUTS; i++) {
+        out << CSVDELIMITER << outputNames[i];
+    }
+
+    out << "\n";
+}
+
+void writeResult(ostream &out, const Result &res) {
+
+    out << res.index << defaultfloat << setprecision(10);
+
+    for (size_t i=0; i<CONFFIELDS; i++) {
+        out << CSVDELIMITER << res.in[i];
+    }
+
+    for (size_t i=0; i<CALCOUTPUTS; i++) {
+        out << CSVDELIMITER << res.out[i];
+    }
+
+    out << "\n";
+}
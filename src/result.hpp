@@ -0,0 +1,43 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: result.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESULT_HPP
+#define RESULT_HPP
+
+#include <cstdint>
+#include <string>
+#include <ostream>
+
+#include "const.hpp"
+
+// one case of a multi-case run: all inputs and the scalar outputs
+struct Result {
+    uint64_t index = 0;
+    double in[CONFFIELDS] = {};
+    double out[CALCOUTPUTS] = {};
+};
+
+const char *outputName(size_t);
+size_t outputIndex(const std::string &); // CALCOUTPUTS if unknown
+
+void writeResultHeader(std::ostream &);
+void writeResult(std::ostream &, const Result &);
+
+#endif // RESULT_HPP
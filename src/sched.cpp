@@ -0,0 +1,324 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: sched.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sched.hpp"
+#include "const.hpp"
+
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::vector;
+using std::unique_ptr;
+using std::function;
+using std::min;
+using std::max;
+
+namespace {
+
+// pins the calling thread to the w-th core allowed for the process
+void pinThread(size_t w) {
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+
+    const int cores = CPU_COUNT(&allowed);
+
+    if (cores == 0) {
+        return;
+    }
+
+    int target = w % cores;
+
+    for (int cpu=0; cpu<CPU_SETSIZE; cpu++) {
+
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+
+        if (target-- == 0) {
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+            return;
+        }
+    }
+#else
+    (void)w;
+#endif
+}
+
+}
+
+void Sched::pin(size_t w) {
+    pinThread(w);
+}
+
+Sched::Sched(size_t threads, bool pin) {
+
+    m_workers = (threads > 0) ? threads : thread::hardware_concurrency();
+
+    if (m_workers == 0) {
+        m_workers = 1;
+    }
+
+    m_pin = pin;
+}
+
+void Sched::run(
+    size_t n,
+    const function<double(size_t)> &cost,
+    const function<void(size_t)> &init,
+    const function<void(size_t, size_t)> &work
+    ) {
+
+    if (n == 0) {
+        return;
+    }
+
+    // The grain is a part of the total cost. When a sample of jobs costs
+    // the same, every job is taken to cost that much and the grain is a
+    // number of jobs. Otherwise the jobs are split into at most
+    // SCHEDBLOCKS blocks and every job is taken to cost the mean of a few
+    // jobs of its block; the blocks are estimated by all workers before
+    // the run, so no cost is estimated under the lock of a range and the
+    // estimates do not grow with the number of jobs.
+
+    const size_t samples = min(n, size_t(1024));
+    double lo = cost(0);
+    double hi = lo;
+
+    for (size_t i=1; i<samples; i++) {
+        const double c = cost(i * n / samples);
+        lo = min(lo, c);
+        hi = max(hi, c);
+    }
+
+    m_costs.clear();
+
+    if (lo == hi) {
+        m_grain = max(double(n / (m_workers * SCHEDCHUNKS)), 1.0);
+    }
+    else {
+
+        m_block = (n + SCHEDBLOCKS - 1) / SCHEDBLOCKS;
+
+        const size_t blocks = (n + m_block - 1) / m_block;
+
+        m_costs.assign(blocks, 0);
+
+        vector<thread> estimators;
+
+        for (size_t w=0; w<m_workers; w++) {
+            estimators.push_back(thread([&, w]() {
+                for (size_t b=blocks*w/m_workers; b<blocks*(w+1)/m_workers; b++) {
+
+                    const size_t from = b * m_block;
+                    const size_t jobs = min(n, from + m_block) - from;
+                    const size_t k = min(jobs, size_t(SCHEDSAMPLES));
+
+                    double sum = 0;
+
+                    for (size_t i=0; i<k; i++) {
+                        sum += cost(from + i * jobs / k);
+                    }
+
+                    m_costs[b] = sum / k;
+                }
+            }));
+        }
+
+        for (size_t w=0; w<m_workers; w++) {
+            estimators[w].join();
+        }
+
+        double sum = 0;
+
+        for (size_t b=0; b<blocks; b++) {
+            sum += m_costs[b] * (min(n, (b + 1) * m_block) - b * m_block);
+        }
+
+        m_grain = sum / (m_workers * SCHEDCHUNKS);
+    }
+
+    {
+        lock_guard<mutex> guard(m_rangesLock);
+
+        m_ranges.clear();
+
+        for (size_t w=0; w<m_workers; w++) {
+            m_ranges.push_back(unique_ptr<Range>(new Range()));
+            m_ranges[w]->begin = n * w / m_workers;
+            m_ranges[w]->end = n * (w + 1) / m_workers;
+        }
+    }
+
+    vector<thread> threads;
+
+    for (size_t w=0; w<m_workers; w++) {
+        threads.push_back(thread(&Sched::worker, this, w,
+                                 std::cref(init), std::cref(work)));
+    }
+
+    for (size_t w=0; w<m_workers; w++) {
+        threads[w].join();
+    }
+
+    lock_guard<mutex> guard(m_rangesLock);
+    m_ranges.clear();
+    m_costs.clear();
+}
+
+void Sched::queued(vector<size_t> &depths) const {
+
+    lock_guard<mutex> guard(m_rangesLock);
+
+    depths.assign(m_ranges.size(), 0);
+
+    for (size_t w=0; w<m_ranges.size(); w++) {
+        Range &r = *m_ranges[w];
+        lock_guard<mutex> rangeGuard(r.lock);
+        depths[w] = (r.end > r.begin) ? r.end - r.begin : 0;
+    }
+}
+
+void Sched::worker(
+    size_t w,
+    const function<void(size_t)> &init,
+    const function<void(size_t, size_t)> &work
+    ) {
+
+    if (m_pin) {
+        pinThread(w);
+    }
+
+    init(w);
+
+    unsigned seed = w + 1;
+    size_t begin = 0;
+    size_t end = 0;
+
+    for (;;) {
+
+        if (takeChunk(w, begin, end)) {
+            for (size_t j=begin; j<end; j++) {
+                work(w, j);
+            }
+        }
+        else if (!steal(w, seed)) {
+            break;
+        }
+    }
+}
+
+bool Sched::takeChunk(size_t w, size_t &begin, size_t &end) {
+
+    Range &r = *m_ranges[w];
+    lock_guard<mutex> guard(r.lock);
+
+    if (r.begin >= r.end) {
+        return false;
+    }
+
+    begin = r.begin;
+    end = r.begin;
+
+    if (m_costs.empty()) {
+        end = min(r.end, begin + size_t(m_grain));
+    }
+    else {
+
+        double c = 0;
+
+        do {
+            c += m_costs[end / m_block];
+            end++;
+        } while (end < r.end && c < m_grain);
+    }
+
+    r.begin = end;
+
+    return true;
+}
+
+bool Sched::steal(size_t w, unsigned &seed) {
+
+    // xorshift is enough to spread the thieves over the victims
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    const size_t first = seed % m_workers;
+
+    for (size_t k=0; k<m_workers; k++) {
+
+        const size_t v = (first + k) % m_workers;
+
+        if (v == w) {
+            continue;
+        }
+
+        size_t begin = 0;
+        size_t end = 0;
+
+        {
+            Range &r = *m_ranges[v];
+            lock_guard<mutex> guard(r.lock);
+
+            if (r.begin >= r.end) {
+                continue;
+            }
+
+            begin = r.begin + (r.end - r.begin) / 2;
+            end = r.end;
+            r.end = begin;
+        }
+
+        Range &own = *m_ranges[w];
+        lock_guard<mutex> guard(own.lock);
+
+        own.begin = begin;
+        own.end = end;
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,93 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: sched.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCHED_HPP
+#define SCHED_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Work-stealing scheduler for the jobs [0, n) of a multi-case run.
+//
+// Every worker owns a contiguous range of jobs and takes chunks from its
+// front. The chunk is grown until its estimated cost reaches the grain,
+// so cheap jobs are taken in batches and expensive ones one by one. The
+// costs are estimated per block of jobs before the run, and not at all
+// when a sample of them is uniform. An idle worker steals the back half of the range of
+// another worker.
+//
+// Workers are pinned to the cores and init() is called on the worker
+// thread before any job, so the buffers it allocates are first touched
+// by that thread and stay local to its NUMA node.
+class Sched {
+
+public:
+
+    Sched(size_t threads, bool pin);
+
+    size_t workers() const { return m_workers; }
+
+    // pins the calling thread to the w-th core allowed for the process
+    static void pin(size_t w);
+
+    // jobs left in the range of every worker; may be called from any
+    // thread, empty when no run is going on
+    void queued(std::vector<size_t> &) const;
+
+    void run(
+        size_t n,
+        const std::function<double(size_t)> &cost,      // (job)
+        const std::function<void(size_t)> &init,        // (worker)
+        const std::function<void(size_t, size_t)> &work // (worker, job)
+        );
+
+private:
+
+    struct Range {
+        std::mutex lock;
+        size_t begin = 0;
+        size_t end   = 0;
+    };
+
+    void worker(
+        size_t w,
+        const std::function<void(size_t)> &init,
+        const std::function<void(size_t, size_t)> &work
+        );
+
+    bool takeChunk(size_t w, size_t &begin, size_t &end);
+    bool steal(size_t w, unsigned &seed);
+
+    size_t m_workers = 1;
+    bool   m_pin     = true;
+    double m_grain   = 0; // cost of a chunk, or jobs when m_costs is empty
+
+    std::vector<double> m_costs; // of a job of every block, empty when uniform
+    size_t m_block = 1;          // jobs of a block
+
+    std::vector<std::unique_ptr<Range>> m_ranges;
+    mutable std::mutex m_rangesLock; // guards m_ranges itself, not the ranges
+
+};
+
+#endif // SCHED_HPP
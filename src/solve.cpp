@@ -0,0 +1,581 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: solve.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "solve.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "calc.hpp"
+#include "cycle.hpp"
+#include "sweep.hpp"
+#include "sched.hpp"
+#include "result.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <regex>
+#include <limits>
+#include <cmath>
+#include <cfloat>
+#include <iomanip>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::sort;
+using std::regex;
+using std::smatch;
+using std::regex_match;
+using std::numeric_limits;
+using std::setprecision;
+using std::defaultfloat;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace {
+
+// Root finder of one worker. f(x) is the output minus the target with
+// the input set to x; the last evaluation is left in out.
+struct Solver {
+
+    Conf   conf;
+    size_t field  = 0;
+    size_t output = 0;
+    double target = 0;
+    double lo = -numeric_limits<double>::infinity();
+    double hi =  numeric_limits<double>::infinity();
+
+    double out[CALCOUTPUTS] = {};
+    size_t evals = 0;
+
+    // the last solutions of the consecutive jobs
+    size_t last = numeric_limits<size_t>::max();
+    size_t chain = 0;
+    double x1 = 0;
+    double x2 = 0;
+
+    vector<Solve::Row> rows;
+
+    double f(double x) {
+
+        conf.setValue(field, x);
+        conf.evaluate();
+
+        if (!cycleValidAngles(conf.val_teta(), conf.val_phiz(), conf.val_da())) {
+            evals++;
+            return numeric_limits<double>::quiet_NaN();
+        }
+
+        cycleStream(conf, nullptr, nullptr, nullptr, out);
+        evals++;
+        return out[output] - target;
+    }
+
+    double clamp(double x) const {
+        return
+            std::min(std::max(x, lo), hi);
+    }
+
+    bool bracket(double &a, double &fa, double &b, double &fb);
+    bool brent(double a, double fa, double b, double fb, double &x);
+};
+
+bool sameSign(double x, double y) {
+    return
+        (x > 0 && y > 0) || (x < 0 && y < 0);
+}
+
+bool Solver::bracket(double &a, double &fa, double &b, double &fb) {
+
+    fa = f(a);
+
+    if (fa == 0 || !std::isfinite(fa)) {
+        b = a;
+        fb = fa;
+        return fa == 0;
+    }
+
+    fb = f(b);
+
+    // the point of the smaller residual is moved away from the other one
+
+    while (std::isfinite(fb) && sameSign(fa, fb)) {
+
+        if (evals >= SOLVEMAXEVALS) {
+            return false;
+        }
+
+        const double na = clamp(a + 1.6 * (a - b));
+        const double nb = clamp(b + 1.6 * (b - a));
+
+        if (fabs(fa) < fabs(fb) && na != a) {
+            a = na;
+            fa = f(a);
+            if (!std::isfinite(fa)) {
+                return false;
+            }
+        }
+        else if (nb != b) {
+            b = nb;
+            fb = f(b);
+        }
+        else if (na != a) {
+            a = na;
+            fa = f(a);
+            if (!std::isfinite(fa)) {
+                return false;
+            }
+        }
+        else {
+            return false; // both ends are at the limits
+        }
+    }
+
+    return
+        std::isfinite(fb);
+}
+
+// Brent's method on the bracket [a, b]
+bool Solver::brent(double a, double fa, double b, double fb, double &x) {
+
+    const double ftol = SOLVETOL * std::max(1.0, fabs(target));
+
+    if (fa == 0 || fabs(fa) <= ftol) {
+        x = a;
+        return true;
+    }
+
+    double c = b;
+    double fc = fb;
+    double d = b - a;
+    double e = d;
+
+    while (evals < SOLVEMAXEVALS) {
+
+        if (sameSign(fb, fc)) {
+            c = a;
+            fc = fa;
+            d = b - a;
+            e = d;
+        }
+
+        if (fabs(fc) < fabs(fb)) {
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
+        }
+
+        const double tol = 4.0 * DBL_EPSILON * (fabs(b) + 1.0);
+        const double xm = 0.5 * (c - b);
+
+        if (fb == 0 || fabs(fb) <= ftol) {
+            x = b;
+            return true;
+        }
+
+        // the bracket collapsed onto a jump of the output, e.g. where
+        // the start of the fire phase moves to the next grid point
+        if (fabs(xm) <= tol) {
+            x = b;
+            return false;
+        }
+
+        if (fabs(e) >= tol && fabs(fa) > fabs(fb)) {
+
+            // inverse quadratic interpolation or the secant
+
+            const double s = fb / fa;
+            double p = 0;
+            double q = 0;
+
+            if (a == c) {
+                p = 2.0 * xm * s;
+                q = 1.0 - s;
+            }
+            else {
+                const double qa = fa / fc;
+                const double r = fb / fc;
+                p = s * (2.0 * xm * qa * (qa - r) - (b - a) * (r - 1.0));
+                q = (qa - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+
+            if (p > 0) {
+                q = -q;
+            }
+
+            p = fabs(p);
+
+            if (2.0 * p < std::min(3.0 * xm * q - fabs(tol * q), fabs(e * q))) {
+                e = d;
+                d = p / q;
+            }
+            else {
+                d = xm;
+                e = d;
+            }
+        }
+        else {
+            d = xm;
+            e = d;
+        }
+
+        a = b;
+        fa = fb;
+
+        b += (fabs(d) > tol) ? d : (xm > 0 ? tol : -tol);
+        fb = f(b);
+
+        if (!std::isfinite(fb)) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+bool lessIndex(const Solve::Row &a, const Solve::Row &b) {
+    return
+        (a.index != b.index) ? a.index < b.index : a.target < b.target;
+}
+
+}
+
+Solve::Solve(const shared_ptr<Conf> &conf,
+             const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+bool Solve::parseSpec() {
+
+    const string spec = m_opts->val_solvespec();
+
+    smatch m;
+
+    if (!regex_match(spec, m, regex("^([A-Za-z_0-9]+):([A-Za-z_0-9]+)=(.+)$"))) {
+        cout << ERRORMSGBLANK << "Wrong solve spec \"" << spec
+             << "\", \"input:output=target\" expected!\n";
+        return false;
+    }
+
+    m_field = Conf::keyIndex(m[1]);
+    m_output = outputIndex(m[2]);
+
+    // boost is not continuous
+    if (m_field == CONFFIELDS || m_field == 0) {
+        cout << ERRORMSGBLANK << "Wrong input \"" << m[1] << "\" to solve for!\n";
+        return false;
+    }
+
+    if (m_output == CALCOUTPUTS) {
+        cout << ERRORMSGBLANK << "Unknown output \"" << m[2] << "\"!\n";
+        return false;
+    }
+
+    vector<string> range;
+    splitString(m[3], range, ELEMDELIMITER);
+
+    m_targets.clear();
+
+    if (range.size() == 1) {
+        m_targets.push_back(stringToDouble(range[0]));
+    }
+    else if (range.size() == 3) {
+
+        const double from = stringToDouble(range[0]);
+        const double to   = stringToDouble(range[1]);
+        const double step = stringToDouble(range[2]);
+
+        if (step <= 0 || to < from) {
+            cout << ERRORMSGBLANK << "Wrong range of targets \"" << m[3] << "\"!\n";
+            return false;
+        }
+
+        const size_t count = floor((to - from) / step + 1e-9) + 1;
+
+        for (size_t i=0; i<count; i++) {
+            m_targets.push_back(from + step * i);
+        }
+    }
+    else {
+        cout << ERRORMSGBLANK << "Wrong targets \"" << m[3] << "\"!\n";
+        return false;
+    }
+
+    m_bracket = !m_opts->val_bracket().empty();
+
+    if (m_bracket) {
+
+        vector<string> elem;
+        splitString(m_opts->val_bracket(), elem, ELEMDELIMITER);
+
+        if (elem.size() == 2) {
+            m_lo = stringToDouble(elem[0]);
+            m_hi = stringToDouble(elem[1]);
+        }
+
+        if (elem.size() != 2 || !(m_lo < m_hi)) {
+            cout << ERRORMSGBLANK << "Wrong bracket \"" << m_opts->val_bracket()
+                 << "\", \"lo,hi\" expected!\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Solve::run() {
+
+    if (!parseSpec()) {
+        return false;
+    }
+
+    // the cases of the sweep or the table, or the configuration alone
+
+    Sweep sweep;
+    size_t cases = 1;
+
+    if (m_opts->val_sweep()) {
+
+        const bool table = !m_opts->val_tablefile().empty();
+
+        if (table ? !sweep.readTableFile(m_opts->val_tablefile()) :
+            m_opts->val_doe() ? !sweep.readDoeFile(m_opts->val_doefile()) :
+            !sweep.readSweepFile(m_opts->val_sweepfile())) {
+            return false;
+        }
+
+        cases = sweep.size();
+    }
+
+    // the targets vary fastest, so the neighbor jobs are the close ones
+    const size_t targets = m_targets.size();
+    const size_t n = cases * targets;
+
+    const Conf &base = *m_conf;
+
+    Sched sched(m_opts->val_threads(), m_opts->val_pin());
+    vector<unique_ptr<Solver>> solvers(sched.workers());
+
+    cout << MSGBLANK << n << " targets, " << sched.workers() << " worker(s).\n";
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    sched.run(
+        n,
+        [&](size_t job) {
+            Conf conf(base);
+            if (m_opts->val_sweep()) {
+                sweep.makeConf(job / targets, conf);
+            }
+            return Calc::cost(conf);
+        },
+        [&](size_t w) {
+            Solver *solver = new Solver();
+            solver->field = m_field;
+            solver->output = m_output;
+            if (m_bracket) {
+                solver->lo = m_lo;
+                solver->hi = m_hi;
+            }
+            solvers[w].reset(solver);
+        },
+        [&](size_t w, size_t job) {
+
+            Solver &s = *solvers[w];
+
+            s.conf = base;
+
+            if (m_opts->val_sweep()) {
+                sweep.makeConf(job / targets, s.conf);
+            }
+
+            s.target = m_targets[job % targets];
+            s.evals = 0;
+
+            if (s.last + 1 != job) {
+                s.chain = 0;
+            }
+
+            // start from the extrapolation of the previous solutions,
+            // else from the bracket or the value of the case
+
+            double a = s.clamp(s.conf.value(m_field));
+            double h = SOLVESTEP * std::max(1.0, fabs(a));
+            double b = 0;
+
+            if (s.chain >= 2) {
+                a = s.clamp(2.0 * s.x1 - s.x2);
+                h = std::max(fabs(s.x1 - s.x2), 0.1 * SOLVESTEP * std::max(1.0, fabs(a)));
+                b = s.clamp(a + h);
+            }
+            else if (s.chain == 1) {
+                a = s.x1;
+                b = s.clamp(a + h);
+            }
+            else if (m_bracket) {
+                a = m_lo;
+                b = m_hi;
+            }
+            else {
+                b = s.clamp(a + h);
+            }
+
+            if (b == a) {
+                b = s.clamp(a - h);
+            }
+
+            double fa = 0;
+            double fb = 0;
+            double x = a;
+
+            Row row;
+
+            row.index = job / targets;
+            row.target = s.target;
+            row.converged = s.bracket(a, fa, b, fb) && s.brent(a, fa, b, fb, x);
+
+            // the results at the solution itself
+            s.f(x);
+
+            row.evals = s.evals;
+            s.conf.values(row.in);
+            std::copy(s.out, s.out + CALCOUTPUTS, row.out);
+
+            if (row.converged) {
+                s.x2 = s.x1;
+                s.x1 = x;
+                s.chain++;
+            }
+            else {
+                s.chain = 0;
+            }
+
+            s.last = job;
+            s.rows.push_back(row);
+        }
+        );
+
+    const duration<double> elapsed = steady_clock::now() - start;
+
+    vector<Row> rows;
+    rows.reserve(n);
+
+    size_t evals = 0;
+    size_t failed = 0;
+
+    for (size_t w=0; w<solvers.size(); w++) {
+        if (solvers[w]) {
+            for (size_t i=0; i<solvers[w]->rows.size(); i++) {
+                evals += solvers[w]->rows[i].evals;
+                failed += solvers[w]->rows[i].converged ? 0 : 1;
+            }
+            rows.insert(rows.end(), solvers[w]->rows.begin(), solvers[w]->rows.end());
+            solvers[w].reset();
+        }
+    }
+
+    sort(rows.begin(), rows.end(), lessIndex);
+
+    cout << MSGBLANK << n << " targets solved in " << elapsed.count() << " s, "
+         << evals << " evaluations";
+
+    if (failed > 0) {
+        cout << ", " << failed << " not converged";
+    }
+
+    cout << ".\n";
+
+    return
+        createReport(rows);
+}
+
+bool Solve::createReport(const vector<Row> &rows) const {
+
+    string reportFilename = m_opts->val_output();
+
+    if (reportFilename.empty()) {
+        reportFilename = string(PRGNAME) + "_solve_" + currDateTime() + ".csv";
+    }
+
+    const string tmpFilename = reportFilename + ".tmp";
+
+    ofstream fout(tmpFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    fout << "index" << CSVDELIMITER << "target";
+
+    for (size_t i=0; i<CONFFIELDS; i++) {
+        fout << CSVDELIMITER << Conf::key(i);
+    }
+
+    for (size_t i=0; i<CALCOUTPUTS; i++) {
+        fout << CSVDELIMITER << outputName(i);
+    }
+
+    fout << CSVDELIMITER << "evals" << CSVDELIMITER << "converged\n";
+
+    fout << defaultfloat << setprecision(10);
+
+    for (size_t r=0; r<rows.size(); r++) {
+
+        fout << rows[r].index << CSVDELIMITER << rows[r].target;
+
+        for (size_t i=0; i<CONFFIELDS; i++) {
+            fout << CSVDELIMITER << rows[r].in[i];
+        }
+
+        for (size_t i=0; i<CALCOUTPUTS; i++) {
+            fout << CSVDELIMITER << rows[r].out[i];
+        }
+
+        fout << CSVDELIMITER << rows[r].evals
+             << CSVDELIMITER << (rows[r].converged ? 1 : 0) << "\n";
+    }
+
+    fout.close();
+
+    if (!fout || !replaceFile(tmpFilename, reportFilename)) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << reportFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\" created.\n\n";
+
+    return true;
+}
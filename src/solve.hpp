@@ -0,0 +1,77 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: solve.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOLVE_HPP
+#define SOLVE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "const.hpp"
+#include "conf.hpp"
+#include "opts.hpp"
+
+// Inverse mode: for every case of the sweep (or the single case of the
+// configuration) and every target value finds the value of one input
+// which gives the target value of one output.
+//
+// The root is bracketed by expanding steps from the start point and
+// refined by Brent's method. A worker solves neighboring jobs in order,
+// so each solution starts from the extrapolation of the previous ones.
+class Solve {
+
+public:
+
+    Solve(const std::shared_ptr<Conf> &conf,
+          const std::shared_ptr<Opts> &opts);
+
+    bool run();
+
+    // the solution of one job
+    struct Row {
+        uint64_t index     = 0;
+        double   target    = 0;
+        double   in[CONFFIELDS]   = {};
+        double   out[CALCOUTPUTS] = {};
+        size_t   evals     = 0;
+        bool     converged = false;
+    };
+
+private:
+
+    bool parseSpec();
+    bool createReport(const std::vector<Row> &) const;
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+
+    size_t m_field  = 0;
+    size_t m_output = 0;
+    std::vector<double> m_targets;
+
+    double m_lo = 0;
+    double m_hi = 0;
+    bool   m_bracket = false;
+
+};
+
+#endif // SOLVE_HPP
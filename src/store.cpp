@@ -0,0 +1,343 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: store.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "store.hpp"
+#include "const.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "result.hpp"
+#include "mapfile.hpp"
+#include "filter.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/file.h>
+#endif
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ostream;
+using std::min;
+using std::numeric_limits;
+using std::setprecision;
+using std::defaultfloat;
+
+namespace {
+
+struct StoreHeader {
+    char     magic[8];
+    uint64_t columns;
+    uint64_t recordSize;
+    uint64_t blockRecords;
+    uint64_t records;
+    uint64_t runs;
+};
+
+struct StoreBlock {
+    uint64_t count;
+    uint64_t reserved;
+    double   min[STORECOLUMNS];
+    double   max[STORECOLUMNS];
+};
+
+const char storeMagic[8] = { 'V', 'I', 'B', 'E', '7', '2', 'S', '1' };
+
+const size_t blockBytes = sizeof(StoreBlock) + STOREBLOCK * sizeof(StoreRecord);
+
+uint64_t blockOffset(uint64_t block) {
+    return
+        sizeof(StoreHeader) + block * blockBytes;
+}
+
+uint64_t recordOffset(uint64_t record) {
+    return
+        blockOffset(record / STOREBLOCK) + sizeof(StoreBlock) +
+        (record % STOREBLOCK) * sizeof(StoreRecord);
+}
+
+StoreHeader makeHeader() {
+
+    StoreHeader header;
+
+    memcpy(header.magic, storeMagic, sizeof(header.magic));
+    header.columns = STORECOLUMNS;
+    header.recordSize = sizeof(StoreRecord);
+    header.blockRecords = STOREBLOCK;
+    header.records = 0;
+    header.runs = 0;
+
+    return header;
+}
+
+// the layout of the file must be the one of this build
+bool sameLayout(const StoreHeader &a, const StoreHeader &b) {
+    return
+        memcmp(a.magic, b.magic, sizeof(a.magic)) == 0 &&
+        a.columns == b.columns &&
+        a.recordSize == b.recordSize &&
+        a.blockRecords == b.blockRecords;
+}
+
+void clearBlock(StoreBlock &block) {
+
+    block.count = 0;
+    block.reserved = 0;
+
+    for (size_t i=0; i<STORECOLUMNS; i++) {
+        block.min[i] = numeric_limits<double>::infinity();
+        block.max[i] = -numeric_limits<double>::infinity();
+    }
+}
+
+// the store may be larger than a long can address
+int seekFile(FILE *f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, offset, SEEK_SET);
+#endif
+}
+
+bool writeAt(FILE *f, uint64_t offset, const void *data, size_t size) {
+    return
+        seekFile(f, offset) == 0 &&
+        fwrite(data, size, 1, f) == 1;
+}
+
+bool readAt(FILE *f, uint64_t offset, void *data, size_t size) {
+    return
+        seekFile(f, offset) == 0 &&
+        fread(data, size, 1, f) == 1;
+}
+
+}
+
+const char *storeColumnName(size_t idx) {
+    return
+        (idx < CONFFIELDS) ? Conf::key(idx) : outputName(idx - CONFFIELDS);
+}
+
+size_t storeColumnIndex(const string &name) {
+
+    const size_t out = outputIndex(name);
+
+    if (out != CALCOUTPUTS) {
+        return CONFFIELDS + out;
+    }
+
+    const size_t in = Conf::keyIndex(name);
+
+    return
+        (in != CONFFIELDS) ? in : STORECOLUMNS;
+}
+
+Store::Store(const string &filename) {
+    m_filename = filename;
+}
+
+bool Store::append(const vector<Result> &results, uint64_t &run) {
+
+    FILE *f = fopen(m_filename.c_str(), "r+b");
+
+    if (!f) {
+        f = fopen(m_filename.c_str(), "w+b");
+    }
+
+    if (!f) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << m_filename << "\" to write!\n";
+        return false;
+    }
+
+#ifndef _WIN32
+    flock(fileno(f), LOCK_EX);
+#endif
+
+    StoreHeader header;
+
+    if (!readAt(f, 0, &header, sizeof(header))) {
+        header = makeHeader();
+    }
+    else if (!sameLayout(header, makeHeader())) {
+        cout << ERRORMSGBLANK << "File \"" << m_filename
+             << "\" is not a store of this version!\n";
+        fclose(f);
+        return false;
+    }
+
+    run = header.runs;
+
+    uint64_t n = header.records;
+    StoreBlock block;
+    bool ok = true;
+
+    for (size_t i=0; i<results.size() && ok; i++) {
+
+        const uint64_t b = n / STOREBLOCK;
+
+        // the block index of a half-filled block is continued; the
+        // records beyond the header count are garbage of a killed run
+        if (i == 0 || n % STOREBLOCK == 0) {
+            if (n % STOREBLOCK == 0 || !readAt(f, blockOffset(b), &block, sizeof(block))) {
+                clearBlock(block);
+            }
+            block.count = n % STOREBLOCK;
+        }
+
+        StoreRecord rec;
+
+        rec.run = run;
+        rec.index = results[i].index;
+        memcpy(rec.col, results[i].in, sizeof(results[i].in));
+        memcpy(rec.col + CONFFIELDS, results[i].out, sizeof(results[i].out));
+
+        for (size_t c=0; c<STORECOLUMNS; c++) {
+            if (rec.col[c] < block.min[c]) {
+                block.min[c] = rec.col[c];
+            }
+            if (rec.col[c] > block.max[c]) {
+                block.max[c] = rec.col[c];
+            }
+        }
+
+        block.count++;
+        n++;
+
+        ok = writeAt(f, recordOffset(n - 1), &rec, sizeof(rec));
+
+        if (ok && (n % STOREBLOCK == 0 || i + 1 == results.size())) {
+            ok = writeAt(f, blockOffset(b), &block, sizeof(block));
+        }
+    }
+
+    // the header counts the records only when they are on the disk
+
+    if (ok) {
+        ok = syncFile(f);
+    }
+
+    if (ok) {
+        header.records = n;
+        header.runs++;
+        ok = writeAt(f, 0, &header, sizeof(header)) && syncFile(f);
+    }
+
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << m_filename << "\"!\n";
+    }
+
+    return ok;
+}
+
+bool Store::query(const string &filter, ostream &out, size_t &matched) const {
+
+    matched = 0;
+
+    Filter conds;
+
+    if (!conds.parse(filter)) {
+        return false;
+    }
+
+    MapFile map;
+
+    if (!map.open(m_filename)) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << m_filename << "\" to read!\n";
+        return false;
+    }
+
+    StoreHeader header;
+
+    if (map.size() < sizeof(header)) {
+        cout << ERRORMSGBLANK << "File \"" << m_filename << "\" is not a store!\n";
+        return false;
+    }
+
+    memcpy(&header, map.data(), sizeof(header));
+
+    if (!sameLayout(header, makeHeader())) {
+        cout << ERRORMSGBLANK << "File \"" << m_filename
+             << "\" is not a store of this version!\n";
+        return false;
+    }
+
+    const uint64_t records = header.records;
+
+    if (records > 0 && recordOffset(records - 1) + sizeof(StoreRecord) > map.size()) {
+        cout << ERRORMSGBLANK << "File \"" << m_filename << "\" is truncated!\n";
+        return false;
+    }
+
+    out << "run" << CSVDELIMITER << "index";
+
+    for (size_t c=0; c<STORECOLUMNS; c++) {
+        out << CSVDELIMITER << storeColumnName(c);
+    }
+
+    out << "\n" << defaultfloat << setprecision(10);
+
+    const uint64_t blocks = (records + STOREBLOCK - 1) / STOREBLOCK;
+
+    for (uint64_t b=0; b<blocks; b++) {
+
+        const StoreBlock *block =
+            reinterpret_cast<const StoreBlock *>(map.data() + blockOffset(b));
+
+        if (!conds.mayMatch(block->min, block->max)) {
+            continue;
+        }
+
+        const StoreRecord *recs =
+            reinterpret_cast<const StoreRecord *>(map.data() + blockOffset(b) + sizeof(StoreBlock));
+        const uint64_t count = min<uint64_t>(STOREBLOCK, records - b * STOREBLOCK);
+
+        for (uint64_t r=0; r<count; r++) {
+
+            if (!conds.matches(recs[r].col)) {
+                continue;
+            }
+
+            out << recs[r].run << CSVDELIMITER << recs[r].index;
+
+            for (size_t c=0; c<STORECOLUMNS; c++) {
+                out << CSVDELIMITER << recs[r].col[c];
+            }
+
+            out << "\n";
+
+            matched++;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,75 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: store.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STORE_HPP
+#define STORE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "const.hpp"
+#include "result.hpp"
+
+#define STORECOLUMNS (CONFFIELDS + CALCOUTPUTS)
+
+// one case of a stored run; the columns are the inputs in the order of
+// Conf::key() and then the outputs in the order of outputName()
+struct StoreRecord {
+    uint64_t run = 0;
+    uint64_t index = 0;
+    double col[STORECOLUMNS] = {};
+};
+
+const char *storeColumnName(size_t);
+size_t storeColumnIndex(const std::string &); // STORECOLUMNS if unknown
+
+// Single-file summary store of all runs.
+//
+// The records are fixed-width and grouped in blocks of STOREBLOCK; each
+// block starts with the minimum and the maximum of every column over its
+// records. A query maps the file and skips the blocks whose ranges can
+// not match the filter, so only the candidate blocks are ever read.
+//
+// The appended records are synced before the header counts them, so
+// a killed run leaves the store as it was. Appending processes are
+// serialized by a lock on the file where the OS supports it. The file
+// is in the host byte order.
+class Store {
+
+public:
+
+    Store(const std::string &filename);
+
+    // adds the cases of one run, returns the number of the run
+    bool append(const std::vector<Result> &, uint64_t &run);
+
+    // the records matching the filter (see Filter) are written to the
+    // stream as CSV
+    bool query(const std::string &filter, std::ostream &, size_t &matched) const;
+
+private:
+
+    std::string m_filename;
+
+};
+
+#endif // STORE_HPP
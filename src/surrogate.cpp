@@ -0,0 +1,391 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: surrogate.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "surrogate.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "calc.hpp"
+#include "cycle.hpp"
+#include "sweep.hpp"
+#include "sched.hpp"
+#include "result.hpp"
+#include "enginemap.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <limits>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::mt19937_64;
+using std::uniform_real_distribution;
+using std::numeric_limits;
+using std::setprecision;
+using std::defaultfloat;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+namespace {
+
+void evaluate(const Conf &conf, double *out) {
+
+    if (cycleValidAngles(conf.val_teta(), conf.val_phiz(), conf.val_da())) {
+        cycleStream(conf, nullptr, nullptr, nullptr, out);
+    }
+    else {
+        std::fill(out, out + CALCOUTPUTS, numeric_limits<double>::quiet_NaN());
+    }
+}
+
+}
+
+Surrogate::Surrogate(const shared_ptr<Conf> &conf,
+                     const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+bool Surrogate::build() const {
+
+    Sweep sweep;
+
+    if (!sweep.readSweepFile(m_opts->val_sweepfile())) {
+        return false;
+    }
+
+    const vector<size_t> &keys = sweep.keys();
+    const size_t points = sweep.size();
+
+    // only the varied keys are the axes of the map; the others are fixed
+    // values of every node, the same for the check points
+
+    vector<EngineMapAxis> axes;
+    vector<size_t> fixedKeys;
+    vector<double> fixedValues;
+
+    for (size_t a=0; a<keys.size(); a++) {
+
+        const vector<double> &values = sweep.values()[a];
+
+        if (values.size() == 1) {
+            fixedKeys.push_back(keys[a]);
+            fixedValues.push_back(values[0]);
+            continue;
+        }
+
+        EngineMapAxis axis;
+
+        axis.key = keys[a];
+        axis.size = values.size();
+        axis.from = values[0];
+        axis.step = (values[values.size()-1] - values[0]) / (values.size() - 1);
+
+        axes.push_back(axis);
+    }
+
+    if (axes.empty() || axes.size() > MAPMAXAXES) {
+        cout << ERRORMSGBLANK << "1 to " << MAPMAXAXES
+             << " varied parameters are expected in the map!\n";
+        return false;
+    }
+
+    const Conf &base = *m_conf;
+
+    Sched sched(m_opts->val_threads(), m_opts->val_pin());
+    vector<unique_ptr<Conf>> confs(sched.workers());
+
+    cout << MSGBLANK << points << " nodes, " << sched.workers() << " worker(s).\n";
+
+    // the nodes
+
+    vector<double> values(points * CALCOUTPUTS, 0);
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    sched.run(
+        points,
+        [&](size_t job) {
+            Conf conf(base);
+            sweep.makeConf(job, conf);
+            return Calc::cost(conf);
+        },
+        [&](size_t w) {
+            confs[w].reset(new Conf(base));
+        },
+        [&](size_t w, size_t job) {
+            Conf &conf = *confs[w];
+            conf = base;
+            sweep.makeConf(job, conf);
+            evaluate(conf, values.data() + job * CALCOUTPUTS);
+        }
+        );
+
+    const duration<double> elapsed = steady_clock::now() - start;
+
+    // the check points, uniformly within the map
+
+    mt19937_64 rng(1);
+
+    vector<double> checkX(MAPCHECKS * axes.size(), 0);
+    vector<double> checkOut(MAPCHECKS * CALCOUTPUTS, 0);
+
+    for (size_t i=0; i<MAPCHECKS; i++) {
+        for (size_t a=0; a<axes.size(); a++) {
+            const double to = axes[a].from + axes[a].step * (axes[a].size - 1);
+            checkX[i * axes.size() + a] =
+                uniform_real_distribution<double>(axes[a].from, to)(rng);
+        }
+    }
+
+    sched.run(
+        MAPCHECKS,
+        [&](size_t) {
+            return 1.0;
+        },
+        [&](size_t w) {
+            confs[w].reset(new Conf(base));
+        },
+        [&](size_t w, size_t job) {
+            Conf &conf = *confs[w];
+            conf = base;
+            for (size_t f=0; f<fixedKeys.size(); f++) {
+                conf.setValue(fixedKeys[f], fixedValues[f]);
+            }
+            for (size_t a=0; a<axes.size(); a++) {
+                conf.setValue(axes[a].key, checkX[job * axes.size() + a]);
+            }
+            conf.evaluate();
+            evaluate(conf, checkOut.data() + job * CALCOUTPUTS);
+        }
+        );
+
+    EngineMapHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, engineMapMagic, sizeof(header.magic));
+
+    string data;
+    uint64_t hash = hashString("");
+
+    if (readFile(CONFIGFILE, data)) {
+        hash = hashString(data, hash);
+    }
+
+    if (readFile(m_opts->val_sweepfile(), data)) {
+        hash = hashString(data, hash);
+    }
+
+    const string source = hashToString(hash);
+    memcpy(header.source, source.data(), std::min(source.size(), sizeof(header.source)));
+
+    header.axes = axes.size();
+    header.outputs = CALCOUTPUTS;
+    header.points = points;
+
+    // the errors of the points where the model is defined
+
+    double out[CALCOUTPUTS];
+
+    const steady_clock::time_point queryStart = steady_clock::now();
+
+    for (size_t i=0; i<MAPCHECKS; i++) {
+
+        EngineMap::interpolate(axes.data(), axes.size(), values.data(),
+                               checkX.data() + i * axes.size(), out);
+
+        for (size_t k=0; k<CALCOUTPUTS; k++) {
+
+            const double exact = checkOut[i * CALCOUTPUTS + k];
+
+            if (std::isnan(exact) || std::isnan(out[k])) {
+                continue;
+            }
+
+            const double err = fabs(out[k] - exact);
+
+            header.checks += (k == 0) ? 1 : 0;
+            header.maxError[k] = std::max(header.maxError[k], err);
+            header.maxRelError[k] =
+                std::max(header.maxRelError[k], err / std::max(fabs(exact), 1e-300));
+        }
+    }
+
+    const duration<double> queryTime = steady_clock::now() - queryStart;
+
+    string mapFilename = m_opts->val_output();
+
+    if (mapFilename.empty()) {
+        mapFilename = MAPFILE;
+    }
+
+    const string tmpFilename = mapFilename + ".tmp";
+
+    FILE *f = fopen(tmpFilename.c_str(), "wb");
+
+    if (!f) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    bool ok =
+        fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(axes.data(), sizeof(EngineMapAxis), axes.size(), f) == axes.size() &&
+        fwrite(values.data(), sizeof(double), values.size(), f) == values.size();
+
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || !replaceFile(tmpFilename, mapFilename)) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << mapFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << points << " nodes calculated in " << elapsed.count() << " s.\n";
+    cout << MSGBLANK << "Query " << queryTime.count() / MAPCHECKS * 1e6
+         << " us, model " << elapsed.count() * sched.workers() / points * 1e6
+         << " us per point.\n";
+    cout << MSGBLANK << "Max error on " << header.checks << " check points:\n";
+
+    for (size_t k=0; k<CALCOUTPUTS; k++) {
+        cout << "\t" << outputName(k) << "\t" << header.maxError[k]
+             << " (" << header.maxRelError[k] * 100.0 << " %)\n";
+    }
+
+    cout << MSGBLANK << "Map file \"" << mapFilename << "\" created.\n\n";
+
+    return true;
+}
+
+bool Surrogate::query() const {
+
+    EngineMap map;
+
+    if (!map.open(m_opts->val_mapfile())) {
+        return false;
+    }
+
+    Sweep table;
+
+    if (!table.readTableFile(m_opts->val_tablefile())) {
+        return false;
+    }
+
+    const size_t axes = map.axes();
+
+    // the column of every axis, the axes missing in the table keep their
+    // first value
+
+    vector<size_t> cols(axes, table.keys().size());
+    vector<double> x(axes, 0);
+
+    for (size_t a=0; a<axes; a++) {
+
+        x[a] = map.axis(a).from;
+
+        for (size_t c=0; c<table.keys().size(); c++) {
+            if (table.keys()[c] == map.axis(a).key) {
+                cols[a] = c;
+            }
+        }
+    }
+
+    string reportFilename = m_opts->val_output();
+
+    if (reportFilename.empty()) {
+        reportFilename = string(PRGNAME) + "_map_" + currDateTime() + ".csv";
+    }
+
+    ofstream fout(reportFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << reportFilename << "\" to write!\n";
+        return false;
+    }
+
+    fout << "index";
+
+    for (size_t a=0; a<axes; a++) {
+        fout << CSVDELIMITER << Conf::key(map.axis(a).key);
+    }
+
+    for (size_t k=0; k<CALCOUTPUTS; k++) {
+        fout << CSVDELIMITER << outputName(k);
+    }
+
+    fout << "\n" << defaultfloat << setprecision(10);
+
+    const vector<vector<double>> &rows = table.rows();
+    double out[CALCOUTPUTS];
+
+    for (size_t r=0; r<rows.size(); r++) {
+
+        for (size_t a=0; a<axes; a++) {
+            if (cols[a] < rows[r].size()) {
+                x[a] = rows[r][cols[a]];
+            }
+        }
+
+        map.query(x.data(), out);
+
+        fout << r;
+
+        for (size_t a=0; a<axes; a++) {
+            fout << CSVDELIMITER << x[a];
+        }
+
+        for (size_t k=0; k<CALCOUTPUTS; k++) {
+            fout << CSVDELIMITER << out[k];
+        }
+
+        fout << "\n";
+    }
+
+    fout.close();
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << reportFilename << "\"!\n";
+        return false;
+    }
+
+    cout << MSGBLANK << rows.size() << " cases answered from the map \""
+         << m_opts->val_mapfile() << "\".\n";
+    cout << MSGBLANK << "Report file \"" << reportFilename << "\" created.\n\n";
+
+    return true;
+}
@@ -0,0 +1,53 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: surrogate.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SURROGATE_HPP
+#define SURROGATE_HPP
+
+#include <memory>
+
+#include "conf.hpp"
+#include "opts.hpp"
+
+// Engine map as a surrogate of the model.
+//
+// build() calculates all nodes of the grid of the sweep file in parallel
+// and writes the map file (see EngineMap). The interpolation error is
+// estimated on MAPCHECKS random points between the nodes, calculated by
+// the model too, and stored in the map. query() answers the cases of a
+// table from the map.
+class Surrogate {
+
+public:
+
+    Surrogate(const std::shared_ptr<Conf> &conf,
+              const std::shared_ptr<Opts> &opts);
+
+    bool build() const;
+    bool query() const;
+
+private:
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+
+};
+
+#endif // SURROGATE_HPP
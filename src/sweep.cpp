@@ -0,0 +1,433 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: sweep.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sweep.hpp"
+#include "const.hpp"
+#include "conf.hpp"
+#include "auxf.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <regex>
+#include <cmath>
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::regex;
+using std::regex_match;
+
+bool Sweep::readSweepFile(const string &filename) {
+
+    ifstream fin(filename);
+
+    if (!fin) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << filename << "\" to read!\n";
+        return false;
+    }
+
+    m_keys.clear();
+    m_values.clear();
+    m_rows.clear();
+    m_doe = Doe();
+
+    string s;
+    vector<string> elem;
+    vector<string> range;
+
+    while (!fin.eof()) {
+
+        getline(fin, s);
+
+        if (regex_match(s, regex(COMMENTREGEX)) || s.empty()) {
+            continue;
+        }
+
+        elem.clear();
+        range.clear();
+
+        splitString(s, elem, PARAMDELIMITER);
+
+        if (elem.size() != 2) {
+            continue;
+        }
+
+        const size_t idx = Conf::keyIndex(elem[0]);
+
+        if (idx == CONFFIELDS) {
+            cout << ERRORMSGBLANK << "Unknown parameter \""
+                 << elem[0] << "\" in file \"" << filename << "\"!\n";
+            return false;
+        }
+
+        splitString(elem[1], range, ELEMDELIMITER);
+
+        vector<double> values;
+
+        if (range.size() == 1) {
+            values.push_back(stringToDouble(range[0]));
+        }
+        else if (range.size() == 3) {
+
+            const double from = stringToDouble(range[0]);
+            const double to   = stringToDouble(range[1]);
+            const double step = stringToDouble(range[2]);
+
+            if (step <= 0 || to < from) {
+                cout << ERRORMSGBLANK << "Wrong range of parameter \""
+                     << elem[0] << "\" in file \"" << filename << "\"!\n";
+                return false;
+            }
+
+            const size_t count = floor((to - from) / step + 1e-9) + 1;
+
+            for (size_t i=0; i<count; i++) {
+                values.push_back(from + step * i);
+            }
+        }
+        else {
+            cout << ERRORMSGBLANK << "Wrong value of parameter \""
+                 << elem[0] << "\" in file \"" << filename << "\"!\n";
+            return false;
+        }
+
+        m_keys.push_back(idx);
+        m_values.push_back(values);
+    }
+
+    fin.close();
+
+    if (m_keys.empty()) {
+        cout << ERRORMSGBLANK << "No parameters in file \""
+             << filename << "\"!\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool Sweep::readTableFile(const string &filename) {
+
+    ifstream fin(filename);
+
+    if (!fin) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << filename << "\" to read!\n";
+        return false;
+    }
+
+    m_keys.clear();
+    m_values.clear();
+    m_rows.clear();
+    m_doe = Doe();
+
+    string s;
+    vector<string> elem;
+
+    while (!fin.eof()) {
+
+        getline(fin, s);
+
+        if (!s.empty() && s[s.size()-1] == '\r') {
+            s.erase(s.size()-1);
+        }
+
+        if (regex_match(s, regex(COMMENTREGEX)) || s.empty()) {
+            continue;
+        }
+
+        elem.clear();
+        splitString(s, elem, CSVDELIMITER);
+
+        if (m_keys.empty()) {
+
+            for (size_t i=0; i<elem.size(); i++) {
+
+                const size_t idx = Conf::keyIndex(elem[i]);
+
+                if (idx == CONFFIELDS) {
+                    cout << ERRORMSGBLANK << "Unknown parameter \""
+                         << elem[i] << "\" in file \"" << filename << "\"!\n";
+                    return false;
+                }
+
+                m_keys.push_back(idx);
+            }
+
+            continue;
+        }
+
+        if (elem.size() != m_keys.size()) {
+            cout << ERRORMSGBLANK << "Wrong number of values in row "
+                 << m_rows.size() + 1 << " of file \"" << filename << "\"!\n";
+            return false;
+        }
+
+        vector<double> row(elem.size(), 0);
+
+        for (size_t i=0; i<elem.size(); i++) {
+            row[i] = stringToDouble(elem[i]);
+        }
+
+        m_rows.push_back(row);
+    }
+
+    fin.close();
+
+    if (m_rows.empty()) {
+        cout << ERRORMSGBLANK << "No cases in file \""
+             << filename << "\"!\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool Sweep::readDoeFile(const string &filename) {
+
+    ifstream fin(filename);
+
+    if (!fin) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << filename << "\" to read!\n";
+        return false;
+    }
+
+    m_keys.clear();
+    m_values.clear();
+    m_rows.clear();
+    m_transforms.clear();
+    m_doe = Doe();
+
+    Doe::Design design = Doe::SOBOL;
+    double points = 0;
+    uint64_t seed = 1;
+    bool scramble = true;
+    size_t dims = 0;
+
+    string s;
+    vector<string> elem;
+    vector<string> range;
+
+    while (!fin.eof()) {
+
+        getline(fin, s);
+
+        if (!s.empty() && s[s.size()-1] == '\r') {
+            s.erase(s.size()-1);
+        }
+
+        if (regex_match(s, regex(COMMENTREGEX)) || s.empty()) {
+            continue;
+        }
+
+        elem.clear();
+        range.clear();
+
+        splitString(s, elem, PARAMDELIMITER);
+
+        if (elem.size() != 2) {
+            continue;
+        }
+
+        if (elem[0] == "design") {
+            if (!Doe::designByName(elem[1], design)) {
+                cout << ERRORMSGBLANK << "Unknown design \""
+                     << elem[1] << "\" in file \"" << filename << "\"!\n";
+                return false;
+            }
+            continue;
+        }
+        else if (elem[0] == "points") {
+            points = stringToDouble(elem[1]);
+            continue;
+        }
+        else if (elem[0] == "seed") {
+            seed = stringToDouble(elem[1]);
+            continue;
+        }
+        else if (elem[0] == "scramble") {
+            scramble = stringToBool(elem[1]);
+            continue;
+        }
+
+        const size_t idx = Conf::keyIndex(elem[0]);
+
+        if (idx == CONFFIELDS) {
+            cout << ERRORMSGBLANK << "Unknown parameter \""
+                 << elem[0] << "\" in file \"" << filename << "\"!\n";
+            return false;
+        }
+
+        splitString(elem[1], range, ELEMDELIMITER);
+
+        vector<double> values;
+        Transform transform = LIN;
+
+        for (size_t i=0; i<range.size() && i<2; i++) {
+            values.push_back(stringToDouble(range[i]));
+        }
+
+        if (range.size() == 3) {
+            if (range[2] == "log") {
+                transform = LOG;
+            }
+            else if (range[2] == "int") {
+                transform = INT;
+            }
+            else if (range[2] != "lin") {
+                range.clear();
+            }
+        }
+
+        if (range.empty() || range.size() > 3 ||
+            (range.size() > 1 && !(values[0] < values[1])) ||
+            (transform == LOG && values[0] <= 0)) {
+            cout << ERRORMSGBLANK << "Wrong value of parameter \""
+                 << elem[0] << "\" in file \"" << filename << "\"!\n";
+            return false;
+        }
+
+        dims += (values.size() == 2);
+
+        m_keys.push_back(idx);
+        m_values.push_back(values);
+        m_transforms.push_back(transform);
+    }
+
+    fin.close();
+
+    if (dims == 0 || points < 1 ||
+        !m_doe.init(design, dims, uint64_t(points), seed, scramble)) {
+        cout << ERRORMSGBLANK << "1 to " << DOEMAXDIMS
+             << " sampled parameters and the points of the design are expected in file \""
+             << filename << "\"!\n";
+        return false;
+    }
+
+    return true;
+}
+
+size_t Sweep::size() const {
+
+    if (!m_rows.empty()) {
+        return m_rows.size();
+    }
+
+    if (m_doe.dims() > 0) {
+        return m_doe.points();
+    }
+
+    if (m_keys.empty()) {
+        return 0;
+    }
+
+    size_t n = 1;
+
+    for (size_t i=0; i<m_values.size(); i++) {
+        n *= m_values[i].size();
+    }
+
+    return n;
+}
+
+bool Sweep::varies(size_t key) const {
+
+    for (size_t i=0; i<m_keys.size(); i++) {
+
+        if (m_keys[i] != key) {
+            continue;
+        }
+
+        if (!m_rows.empty()) {
+            for (size_t r=1; r<m_rows.size(); r++) {
+                if (m_rows[r][i] != m_rows[0][i]) {
+                    return true;
+                }
+            }
+        }
+        else if (m_values[i].size() > 1) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Sweep::makeConf(size_t idx, Conf &conf) const {
+
+    if (!m_rows.empty()) {
+
+        const vector<double> &row = m_rows[idx];
+
+        for (size_t i=0; i<m_keys.size(); i++) {
+            conf.setValue(m_keys[i], row[i]);
+        }
+
+        conf.evaluate();
+
+        return;
+    }
+
+    if (m_doe.dims() > 0) {
+
+        for (size_t i=0, d=0; i<m_keys.size(); i++) {
+
+            const vector<double> &values = m_values[i];
+
+            if (values.size() == 1) {
+                conf.setValue(m_keys[i], values[0]);
+                continue;
+            }
+
+            const double u = m_doe.sample(idx, d++);
+            double val = values[0] + (values[1] - values[0]) * u;
+
+            if (m_transforms[i] == LOG) {
+                val = values[0] * pow(values[1] / values[0], u);
+            }
+            else if (m_transforms[i] == INT) {
+                // every integer of [from, to] gets its equal part
+                val = floor(values[0] + (values[1] - values[0] + 1.0) * u);
+            }
+
+            conf.setValue(m_keys[i], val);
+        }
+
+        conf.evaluate();
+
+        return;
+    }
+
+    for (size_t i=m_keys.size(); i>0; i--) {
+
+        const vector<double> &values = m_values[i-1];
+
+        conf.setValue(m_keys[i-1], values[idx % values.size()]);
+        idx /= values.size();
+    }
+
+    // the expressions of the other fields may depend on the case
+    conf.evaluate();
+}
@@ -0,0 +1,84 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: sweep.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <string>
+#include <vector>
+
+#include "conf.hpp"
+#include "doe.hpp"
+
+// Cases of a multi-case run over some configuration fields.
+//
+// The grid is read from the sweep file, every line of which is
+// "key=from,to,step" or "key=value"; the first key varies slowest. The
+// table is read from the CSV file with the header of keys and a case per
+// row. The design of experiments is read from the DOE file:
+//
+//   design=sobol
+//   points=1000000
+//   seed=1
+//   scramble=1
+//   n=1200,2200
+//   pk=100,400,log
+//   i=4,12,int
+//   teta=14
+//
+// design is sobol, halton or lhs; "key=from,to[,transform]" are the
+// sampled fields, transform is lin (default), log or int; "key=value"
+// are the fixed ones. The cases are numbered, so any case can be built
+// by index; the points of the design are made by index too.
+class Sweep {
+
+public:
+
+    bool readSweepFile(const std::string &);
+    bool readTableFile(const std::string &);
+    bool readDoeFile(const std::string &);
+
+    size_t size() const;
+    void makeConf(size_t, Conf &) const;
+
+    // whether the cases give the field of the index more than one value;
+    // the fixed keys of the grid and of the design do not
+    bool varies(size_t) const;
+
+    // the keys, the values of the grid axes (the bounds of the design)
+    // and the rows of the table
+    const std::vector<size_t> &keys() const { return m_keys; }
+    const std::vector<std::vector<double>> &values() const { return m_values; }
+    const std::vector<std::vector<double>> &rows() const { return m_rows; }
+
+private:
+
+    std::vector<size_t> m_keys;
+    std::vector<std::vector<double>> m_values;
+    std::vector<std::vector<double>> m_rows;
+
+    enum Transform { LIN, LOG, INT };
+
+    Doe m_doe;
+    std::vector<Transform> m_transforms;
+
+};
+
+#endif // SWEEP_HPP
@@ -0,0 +1,156 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: vibe72.h
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+  C interface of the calculation for embedding.
+
+  The calculation never allocates: the caller asks for the sizes of the
+  traces, provides the buffers and gets the results written into them.
+  The functions keep no state and may be called from any number of
+  threads at once. Only opening an engine map allocates its handle.
+*/
+
+#ifndef VIBE72_H
+#define VIBE72_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(VIBE72_BUILD)
+#    define VIBE72_EXPORT __declspec(dllexport)
+#  else
+#    define VIBE72_EXPORT __declspec(dllimport)
+#  endif
+#else
+#  define VIBE72_EXPORT __attribute__((visibility("default")))
+#endif
+
+#define VIBE72_API_VERSION 2
+
+#define VIBE72_OK        0
+#define VIBE72_EINVAL    1  /* null pointer or a wrong parameter */
+#define VIBE72_ECAPACITY 2  /* the trace buffers are too small */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the fields of the configuration file in its order and units */
+typedef struct vibe72_params {
+    int    boost;
+    double n, i, vh, eps, r, l;
+    double p0, t0, muv;
+    double pk, iceff, nk, alpha, etav, pr, tr, dt;
+    double C, H, O, hu;
+    double teta;
+    double n1, n2s;
+    double phiz, ksi, m, da;
+} vibe72_params;
+
+/* number of points of the phases; total is the length of the traces */
+typedef struct vibe72_sizes {
+    size_t comp;
+    size_t fire;
+    size_t exp;
+    size_t total;
+} vibe72_sizes;
+
+/*
+  Caller owned traces of capacity points each: crank angle [deg],
+  pressure [kPa] and temperature [degC]. Any of the arrays may be null
+  if it is not needed; the arrays need no particular alignment.
+*/
+typedef struct vibe72_trace {
+    double *phi;
+    double *p;
+    double *t;
+    size_t  capacity;
+} vibe72_trace;
+
+/* scalar results in the units of the report */
+typedef struct vibe72_outputs {
+    double pe;          /* kPa */
+    double etae;
+    double gi;          /* g/kWh */
+    double ge;          /* g/kWh */
+    double Ne;          /* kW */
+    double P_comp_max;  /* kPa */
+    double P_fire_max;  /* kPa */
+} vibe72_outputs;
+
+VIBE72_EXPORT int vibe72_api_version(void);
+
+/* sizes of the traces of a calculation with these angles */
+VIBE72_EXPORT int vibe72_sizes_query(double da, double teta, double phiz,
+                                     vibe72_sizes *sizes);
+
+/* trace may be null if only the outputs are needed, outputs may be null
+   if only the trace is needed */
+VIBE72_EXPORT int vibe72_calculate(const vibe72_params *params,
+                                   vibe72_trace *trace,
+                                   vibe72_outputs *outputs);
+
+/*
+  Real-time mode for the fixed rate loops. vibe72_rt_prepare() fixes the
+  angles, and so the length of every loop of the calculation, at most
+  VIBE72_RT_MAXPOINTS points; vibe72_rt_calculate() then makes no
+  allocation, system call or I/O and its time is bounded. The angles of
+  its params must be the prepared ones.
+*/
+
+#define VIBE72_RT_MAXPOINTS 65536
+
+typedef struct vibe72_rt {
+    double       da, teta, phiz;
+    vibe72_sizes sizes;
+} vibe72_rt;
+
+VIBE72_EXPORT int vibe72_rt_prepare(double da, double teta, double phiz,
+                                    vibe72_rt *rt);
+
+VIBE72_EXPORT int vibe72_rt_calculate(const vibe72_rt *rt,
+                                      const vibe72_params *params,
+                                      vibe72_trace *trace,
+                                      vibe72_outputs *outputs);
+
+/*
+  Engine map built by "vibe72 --build-map": the outputs interpolated
+  between the nodes of the grid, much cheaper than the calculation.
+  The queries do not allocate and may run in any number of threads.
+*/
+typedef struct vibe72_map vibe72_map;
+
+VIBE72_EXPORT int vibe72_map_open(const char *filename, vibe72_map **map);
+VIBE72_EXPORT void vibe72_map_close(vibe72_map *map);
+
+/* number of the axes and the configuration key of each */
+VIBE72_EXPORT size_t vibe72_map_axes(const vibe72_map *map);
+VIBE72_EXPORT const char *vibe72_map_axis_key(const vibe72_map *map, size_t axis);
+
+/* x holds a value for every axis in their order; the point is clamped
+   to the map */
+VIBE72_EXPORT int vibe72_map_query(const vibe72_map *map, const double *x,
+                                   vibe72_outputs *outputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VIBE72_H */
@@ -0,0 +1,319 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: watch.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "watch.hpp"
+#include "const.hpp"
+#include "prgid.hpp"
+#include "auxf.hpp"
+#include "conf.hpp"
+#include "calc.hpp"
+#include "cycle.hpp"
+#include "result.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <iomanip>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#endif
+
+using std::cout;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::shared_ptr;
+using std::setprecision;
+using std::defaultfloat;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::chrono::milliseconds;
+
+namespace {
+
+const char *phaseName(Calc::Phase phase) {
+
+    static const char *names[] = {
+        "inlet", "grid", "compression", "fire", "expansion", "performance"
+    };
+
+    return names[phase];
+}
+
+#ifndef __linux__
+int64_t modificationStamp(const string &filename) {
+
+    std::error_code err;
+    const std::filesystem::file_time_type t =
+        std::filesystem::last_write_time(filename, err);
+
+    return
+        err ? 0 : t.time_since_epoch().count();
+}
+#endif
+
+}
+
+Watch::Watch(const shared_ptr<Conf> &conf,
+             const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+Watch::~Watch() {
+#ifdef __linux__
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+#endif
+}
+
+bool Watch::run() {
+
+    m_reportFilename = m_opts->val_output();
+
+    if (m_reportFilename.empty()) {
+        m_reportFilename = WATCHFILE;
+    }
+
+    if (!start()) {
+        return false;
+    }
+
+    if (!cycleValidAngles(m_conf->val_teta(), m_conf->val_phiz(), m_conf->val_da())) {
+        cout << ERRORMSGBLANK << "Wrong teta, phiz or da!\n";
+        return false;
+    }
+
+    m_calc.reset(new Calc(m_conf));
+    m_calc->setThreads(m_opts->val_threads());
+
+    if (!m_calc->calculate() || !writeReport()) {
+        return false;
+    }
+
+    cout << MSGBLANK << "Report file \"" << m_reportFilename << "\" created.\n"
+         << MSGBLANK << "Watching \"" << CONFIGFILE
+         << "\", the report is updated on every save.\n\n";
+
+    cout.flush();
+
+    while (wait()) {
+        update();
+        cout.flush();
+    }
+
+    return false;
+}
+
+bool Watch::start() {
+
+#ifdef __linux__
+
+    // the directory, not the file: a rename of a new file over it would
+    // leave the watch on the old inode
+
+    m_fd = inotify_init1(IN_CLOEXEC);
+
+    if (m_fd < 0 ||
+        inotify_add_watch(m_fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        cout << ERRORMSGBLANK << "Can not watch file \"" << CONFIGFILE << "\"!\n";
+        return false;
+    }
+
+#else
+
+    m_stamp = modificationStamp(CONFIGFILE);
+
+#endif
+
+    return true;
+}
+
+bool Watch::wait() {
+
+#ifdef __linux__
+
+    alignas(struct inotify_event) char buf[4096];
+
+    bool changed = false;
+    int timeout = -1;
+
+    // after the first event of the file the others of the same save are
+    // collected for WATCHSETTLEMS
+
+    for (;;) {
+
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+
+        const int ready = poll(&pfd, 1, timeout);
+
+        if (ready < 0) {
+            cout << ERRORMSGBLANK << "Can not watch file \"" << CONFIGFILE << "\"!\n";
+            return false;
+        }
+
+        if (ready == 0) {
+            return true;
+        }
+
+        const ssize_t len = read(m_fd, buf, sizeof(buf));
+
+        if (len <= 0) {
+            cout << ERRORMSGBLANK << "Can not watch file \"" << CONFIGFILE << "\"!\n";
+            return false;
+        }
+
+        for (ssize_t pos=0; pos<len; ) {
+
+            const struct inotify_event *ev =
+                reinterpret_cast<const struct inotify_event *>(buf + pos);
+
+            if (ev->len > 0 && strcmp(ev->name, CONFIGFILE) == 0) {
+                changed = true;
+            }
+
+            pos += sizeof(struct inotify_event) + ev->len;
+        }
+
+        if (changed) {
+            timeout = WATCHSETTLEMS;
+        }
+    }
+
+#else
+
+    for (;;) {
+
+        std::this_thread::sleep_for(milliseconds(WATCHPOLLMS));
+
+        const int64_t stamp = modificationStamp(CONFIGFILE);
+
+        if (stamp != 0 && stamp != m_stamp) {
+            m_stamp = stamp;
+            return true;
+        }
+    }
+
+#endif
+}
+
+void Watch::update() {
+
+    const steady_clock::time_point start = steady_clock::now();
+
+    // a missing file is a save in progress, the blank must not be
+    // created over it
+
+    if (!ifstream(CONFIGFILE)) {
+        return;
+    }
+
+    Conf conf;
+
+    if (!conf.readConfigFile()) {
+        return;
+    }
+
+    vector<size_t> changed;
+    Calc::Phase from = Calc::PERFORMANCE;
+
+    for (size_t i=0; i<CONFFIELDS; i++) {
+        if (conf.value(i) != m_conf->value(i)) {
+            changed.push_back(i);
+            if (Calc::keyPhase(i) < from) {
+                from = Calc::keyPhase(i);
+            }
+        }
+    }
+
+    if (changed.empty()) {
+        return;
+    }
+
+    if (!cycleValidAngles(conf.val_teta(), conf.val_phiz(), conf.val_da())) {
+        cout << ERRORMSGBLANK << "Wrong teta, phiz or da, the change is ignored!\n";
+        return;
+    }
+
+    *m_conf = conf;
+
+    if (!m_calc->recalculate(from) || !writeReport()) {
+        return;
+    }
+
+    const duration<double> elapsed = steady_clock::now() - start;
+
+    double out[CALCOUTPUTS];
+    m_calc->outputs(out);
+
+    cout << MSGBLANK;
+
+    for (size_t i=0; i<changed.size(); i++) {
+        cout << (i > 0 ? ", " : "") << Conf::key(changed[i]) << "=" << conf.value(changed[i]);
+    }
+
+    cout << ": from " << phaseName(from) << " phase in "
+         << elapsed.count() * 1000.0 << " ms\n" << MSGBLANK
+         << defaultfloat << setprecision(6);
+
+    for (size_t i=0; i<CALCOUTPUTS; i++) {
+        cout << (i > 0 ? ", " : "") << outputName(i) << "=" << out[i];
+    }
+
+    cout << "\n";
+}
+
+bool Watch::writeReport() const {
+
+    const string tmpFilename = m_reportFilename + ".tmp";
+
+    ofstream fout(tmpFilename);
+
+    if (!fout) {
+        cout << ERRORMSGBLANK << "Can not open file \""
+             << tmpFilename << "\" to write!\n";
+        return false;
+    }
+
+    m_calc->writeReport(fout);
+
+    fout.close();
+
+    if (!fout || !replaceFile(tmpFilename, m_reportFilename)) {
+        cout << ERRORMSGBLANK << "Can not write file \""
+             << m_reportFilename << "\"!\n";
+        return false;
+    }
+
+    return true;
+}
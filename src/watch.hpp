@@ -0,0 +1,67 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: watch.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WATCH_HPP
+#define WATCH_HPP
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "conf.hpp"
+#include "opts.hpp"
+#include "calc.hpp"
+
+// Interactive tuning. The single case is calculated again whenever the
+// configuration file is saved, from the first phase which reads one of
+// the changed keys, and the report is rewritten under a stable name.
+//
+// On Linux the directory of the file is watched with inotify, so the
+// editors which save through a new file and a rename are seen too; on
+// other systems the modification time is polled every WATCHPOLLMS.
+class Watch {
+
+public:
+
+    Watch(const std::shared_ptr<Conf> &conf,
+          const std::shared_ptr<Opts> &opts);
+    ~Watch();
+
+    bool run(); // until the program is interrupted
+
+private:
+
+    bool start();
+    bool wait();
+    void update();
+    bool writeReport() const;
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+    std::unique_ptr<Calc> m_calc;
+
+    std::string m_reportFilename;
+
+    int     m_fd    = -1; // inotify
+    int64_t m_stamp = 0;  // modification time when polled
+
+};
+
+#endif // WATCH_HPP
@@ -0,0 +1,227 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: wcet.cpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "wcet.hpp"
+#include "const.hpp"
+#include "conf.hpp"
+#include "sched.hpp"
+#include "vibe72.h"
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using std::cout;
+using std::vector;
+using std::shared_ptr;
+using std::mt19937_64;
+using std::uniform_real_distribution;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+namespace {
+
+// the parameters of the C interface, the values in the order of Conf::key()
+void makeParams(const double *values, vibe72_params &pr) {
+
+    pr.boost = values[0] != 0;
+
+    double *const fields[CONFFIELDS-1] = {
+        &pr.n, &pr.i, &pr.vh, &pr.eps, &pr.r, &pr.l,
+        &pr.p0, &pr.t0, &pr.muv,
+        &pr.pk, &pr.iceff, &pr.nk, &pr.alpha, &pr.etav, &pr.pr, &pr.tr, &pr.dt,
+        &pr.C, &pr.H, &pr.O, &pr.hu,
+        &pr.teta,
+        &pr.n1, &pr.n2s,
+        &pr.phiz, &pr.ksi, &pr.m, &pr.da
+    };
+
+    for (size_t i=1; i<CONFFIELDS; i++) {
+        *fields[i-1] = values[i];
+    }
+}
+
+}
+
+Wcet::Wcet(const shared_ptr<Conf> &conf,
+           const shared_ptr<Opts> &opts) {
+    m_conf = conf;
+    m_opts = opts;
+}
+
+bool Wcet::run() {
+
+    const double teta = m_conf->val_teta();
+    const double phiz = m_conf->val_phiz();
+    const double da = m_conf->val_da();
+
+    vibe72_sizes sizes;
+
+    if (vibe72_sizes_query(da, teta, phiz, &sizes) != VIBE72_OK) {
+        cout << ERRORMSGBLANK << "Wrong angles of the configuration!\n";
+        return false;
+    }
+
+    const size_t points = sizes.total;
+
+    vibe72_rt rt;
+
+    if (vibe72_rt_prepare(da, teta, phiz, &rt) != VIBE72_OK) {
+        cout << ERRORMSGBLANK << points << " points of the cycle, the real-time mode allows "
+             << VIBE72_RT_MAXPOINTS << "!\n";
+        return false;
+    }
+
+    const size_t calls = m_opts->val_wcetcalls();
+
+    if (calls == 0) {
+        cout << ERRORMSGBLANK << "No calls to measure!\n";
+        return false;
+    }
+
+    if (m_opts->val_pincore()) {
+        Sched::pin(m_opts->val_core());
+    }
+
+    // everything is allocated before the memory is locked and the calls
+    // are made
+
+    vector<double> phi(points);
+    vector<double> p(points);
+    vector<double> t(points);
+    vector<uint64_t> times(calls);
+
+    double base[CONFFIELDS];
+    m_conf->values(base);
+
+    if (m_opts->val_mlock()) {
+#ifdef __linux__
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            cout << WARNMSGBLANK << "Can not lock the memory.\n";
+        }
+#else
+        cout << WARNMSGBLANK << "Memory locking is not supported.\n";
+#endif
+    }
+
+    const size_t fixed[] = {
+        0,
+        Conf::keyIndex("teta"),
+        Conf::keyIndex("phiz"),
+        Conf::keyIndex("da")
+    };
+
+    mt19937_64 rng(1);
+    uniform_real_distribution<double> spread(1.0 - WCETSPREAD, 1.0 + WCETSPREAD);
+
+    double values[CONFFIELDS];
+    vibe72_params params;
+    vibe72_trace trace = { phi.data(), p.data(), t.data(), points };
+    vibe72_outputs outputs;
+    size_t failed = 0;
+
+    for (size_t c=0; c<WCETWARMUP+calls; c++) {
+
+        // the inputs of the call are drawn outside of the measurement
+
+        for (size_t i=0; i<CONFFIELDS; i++) {
+            values[i] = base[i];
+            if (std::find(fixed, fixed + 4, i) == fixed + 4) {
+                values[i] *= spread(rng);
+            }
+        }
+
+        makeParams(values, params);
+
+        const steady_clock::time_point start = steady_clock::now();
+
+        const int rc = vibe72_rt_calculate(&rt, &params, &trace, &outputs);
+
+        const steady_clock::time_point end = steady_clock::now();
+
+        if (c < WCETWARMUP) {
+            continue;
+        }
+
+        times[c - WCETWARMUP] = duration_cast<nanoseconds>(end - start).count();
+
+        if (rc != VIBE72_OK || !std::isfinite(outputs.P_fire_max)) {
+            failed++;
+        }
+    }
+
+#ifdef __linux__
+    if (m_opts->val_mlock()) {
+        munlockall();
+    }
+#endif
+
+    double sum = 0;
+    size_t misses = 0;
+
+    for (size_t c=0; c<calls; c++) {
+        sum += times[c];
+        misses += (times[c] > WCETDEADLINE * 1000.0);
+    }
+
+    std::sort(times.begin(), times.end());
+
+    // nearest rank
+    const auto percentile = [&](double q) {
+        const size_t rank = std::ceil(q * calls);
+        return times[std::max(rank, size_t(1)) - 1] / 1000.0;
+    };
+
+    cout << MSGBLANK << calls << " calls of " << points << " points";
+
+    if (m_opts->val_pincore()) {
+        cout << ", core " << m_opts->val_core();
+    }
+
+    if (m_opts->val_mlock()) {
+        cout << ", memory locked";
+    }
+
+    cout << ".\n"
+         << MSGBLANK << "Execution time, us: min " << times[0] / 1000.0
+         << ", mean " << sum / calls / 1000.0
+         << ", p99 " << percentile(0.99)
+         << ", p99.99 " << percentile(0.9999)
+         << ", max " << times[calls-1] / 1000.0 << ".\n"
+         << MSGBLANK << misses << " calls over the deadline of " << WCETDEADLINE << " us";
+
+    if (failed > 0) {
+        cout << ", " << failed << " calls without finite results";
+    }
+
+    cout << ".\n\n";
+
+    return true;
+}
@@ -0,0 +1,51 @@
+/*
+  vibe72
+  Termal calculation of four-cycle diesel engines.
+
+  File: wcet.hpp
+
+  Copyright (C) 2021 Artem Petrov <pa23666@yandex.ru>
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WCET_HPP
+#define WCET_HPP
+
+#include <memory>
+
+#include "conf.hpp"
+#include "opts.hpp"
+
+// Measurement harness of the real-time mode (vibe72_rt_calculate() of
+// the C interface): the execution time of every call over the random
+// inputs within WCETSPREAD of the configuration, the angles fixed. The
+// calls run on one thread, optionally pinned to a core (--core) with the
+// memory locked (--mlock); the worst case, the percentiles and the misses
+// of the WCETDEADLINE (us) of the 1 kHz loop are printed.
+class Wcet {
+
+public:
+
+    Wcet(const std::shared_ptr<Conf> &conf,
+         const std::shared_ptr<Opts> &opts);
+
+    bool run();
+
+private:
+
+    std::shared_ptr<Conf> m_conf;
+    std::shared_ptr<Opts> m_opts;
+
+};
+
+#endif // WCET_HPP